@@ -0,0 +1,145 @@
+/**************************************************************************
+*
+* Copyright (c) 2012-2025 Barbara Geller
+*
+* Diamond Editor is free software. You can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Diamond Editor is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* https://www.gnu.org/licenses/
+*
+***************************************************************************/
+
+#include "advfind_model.h"
+
+// longer lines are cut, the full line is shown when the file is opened
+static constexpr const int TEXT_LIMIT = 1000;
+
+AdvFindModel::AdvFindModel(QObject *parent)
+   : QAbstractTableModel(parent)
+{
+}
+
+int AdvFindModel::rowCount(const QModelIndex &parent) const
+{
+   if (parent.isValid()) {
+      return 0;
+   }
+
+   return m_lineColumn.size();
+}
+
+int AdvFindModel::columnCount(const QModelIndex &parent) const
+{
+   if (parent.isValid()) {
+      return 0;
+   }
+
+   return 3;
+}
+
+QVariant AdvFindModel::data(const QModelIndex &index, int role) const
+{
+   if (! index.isValid() || role != Qt::DisplayRole) {
+      return QVariant();
+   }
+
+   const int row = index.row();
+
+   switch (index.column()) {
+      case 0:
+         return get_FileName(row);
+
+      case 1:
+         return get_LineNumber(row);
+
+      case 2:
+         return get_Text(row);
+   }
+
+   return QVariant();
+}
+
+QVariant AdvFindModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+   if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+      return QAbstractTableModel::headerData(section, orientation, role);
+   }
+
+   switch (section) {
+      case 0:
+         return tr("File Name");
+
+      case 1:
+         return tr("Line #");
+
+      case 2:
+         return tr("Text");
+   }
+
+   return QVariant();
+}
+
+void AdvFindModel::appendResults(const QList<advFindStruct> &list)
+{
+   if (list.isEmpty()) {
+      return;
+   }
+
+   const int first = m_lineColumn.size();
+   beginInsertRows(QModelIndex(), first, first + list.size() - 1);
+
+   for (const auto &entry : list) {
+      int fileId = m_fileIds.value(entry.fileName, -1);
+
+      if (fileId == -1) {
+         fileId = m_fileNames.size();
+
+         m_fileNames.append(entry.fileName);
+         m_fileIds.insert(entry.fileName, fileId);
+      }
+
+      QByteArray text = entry.text.toUtf8();
+
+      if (text.size() > TEXT_LIMIT) {
+         int length = TEXT_LIMIT;
+
+         // do not split a multibyte character
+         while (length > 0 && (quint8(text[length]) & 0xC0) == 0x80) {
+            --length;
+         }
+
+         text.truncate(length);
+      }
+
+      m_fileColumn.append(fileId);
+      m_lineColumn.append(entry.lineNumber);
+      m_textOffset.append(m_textArena.size());
+
+      m_textArena.append(text);
+   }
+
+   endInsertRows();
+}
+
+QString AdvFindModel::get_FileName(int row) const
+{
+   return m_fileNames[m_fileColumn[row]];
+}
+
+int AdvFindModel::get_LineNumber(int row) const
+{
+   return m_lineColumn[row];
+}
+
+QString AdvFindModel::get_Text(int row) const
+{
+   const int start = m_textOffset[row];
+   const int end   = (row + 1 < m_textOffset.size()) ? m_textOffset[row + 1] : m_textArena.size();
+
+   return QString::fromUtf8(m_textArena.constData() + start, end - start);
+}
@@ -0,0 +1,65 @@
+/**************************************************************************
+*
+* Copyright (c) 2012-2025 Barbara Geller
+*
+* Diamond Editor is free software. You can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Diamond Editor is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* https://www.gnu.org/licenses/
+*
+***************************************************************************/
+
+#ifndef ADVFIND_MODEL_H
+#define ADVFIND_MODEL_H
+
+#include "advfind_search.h"
+
+#include <QAbstractTableModel>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QModelIndex>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+// results of Advanced Find, one column per field, rows are only appended
+class AdvFindModel : public QAbstractTableModel
+{
+   CS_OBJECT(AdvFindModel)
+
+   public:
+      AdvFindModel(QObject *parent = nullptr);
+
+      int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+      int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+
+      QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+      QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+      void appendResults(const QList<advFindStruct> &list);
+
+      QString get_FileName(int row) const;
+      int get_LineNumber(int row) const;
+      QString get_Text(int row) const;
+
+   private:
+      // each file name is stored once
+      QStringList m_fileNames;
+      QHash<QString, int> m_fileIds;
+
+      QVector<int> m_fileColumn;
+      QVector<int> m_lineColumn;
+
+      // UTF-8 text of every row, row k ends where row k + 1 starts
+      QVector<int> m_textOffset;
+      QByteArray m_textArena;
+};
+
+#endif
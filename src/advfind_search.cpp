@@ -0,0 +1,691 @@
+/**************************************************************************
+*
+* Copyright (c) 2012-2025 Barbara Geller
+*
+* Diamond Editor is free software. You can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Diamond Editor is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* https://www.gnu.org/licenses/
+*
+***************************************************************************/
+
+#include "advfind_model.h"
+#include "advfind_search.h"
+#include "find_pattern.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+static constexpr const int QUEUE_LIMIT = 4096;
+
+// only the start of each file is checked for binary data
+static constexpr const int SNIFF_SIZE = 8192;
+
+// contents of the file, mapped when possible, size is updated when the file had to be read
+static const char *mapFile(QFile &file, QByteArray &buffer, qint64 &size)
+{
+   const char *data = reinterpret_cast<const char *>(file.map(0, size));
+
+   if (data == nullptr) {
+      buffer = file.readAll();
+
+      data = buffer.constData();
+      size = buffer.size();
+   }
+
+   return data;
+}
+
+static QString writeFile(const AdvReplaceFile &replaceFile)
+{
+   QFileInfo info(replaceFile.fileName);
+
+   if (info.size() != replaceFile.size || info.lastModified().toMSecsSinceEpoch() != replaceFile.modified) {
+      return replaceFile.fileName + QObject::tr(": file was changed after the replacements were computed");
+   }
+
+   // written to a temporary file in the same folder and renamed over the original
+   QSaveFile file(replaceFile.fileName);
+
+   if (! file.open(QIODevice::WriteOnly) || file.write(replaceFile.newContents) != replaceFile.newContents.size()
+         || ! file.commit()) {
+      return replaceFile.fileName + ": " + file.errorString();
+   }
+
+   return QString();
+}
+
+static bool hasByteOrderMark(const char *data, qint64 size)
+{
+   return size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0;
+}
+
+class AdvFindTask : public QRunnable
+{
+   public:
+      AdvFindTask(std::function<void ()> func)
+         : m_func(std::move(func))
+      { }
+
+      void run() override {
+         m_func();
+      }
+
+   private:
+      std::function<void ()> m_func;
+};
+
+QEvent::Type AdvFindEvent::eventType()
+{
+   static const QEvent::Type type = static_cast<QEvent::Type>(QEvent::registerEventType());
+
+   return type;
+}
+
+AdvFindSearch::AdvFindSearch(const AdvFindOptions &options)
+   : m_options(options), m_textSearch(nullptr), m_maxFileSize(0), m_isReplace(false), m_index(nullptr), m_model(nullptr),
+     m_eventPosted(false), m_walkDone(false), m_canceled(false), m_fileCount(0), m_filesDone(0), m_queue(QUEUE_LIMIT),
+     m_nextFile(0), m_matchCount(0), m_filesReceived(0), m_walkFinished(false)
+{
+   m_walkPool.setMaxThreadCount(1);
+
+   if (m_options.wholeWords || m_options.regexp) {
+      // same pattern as FindPattern, the find text is only a regular expression in regexp mode
+      QString pattern = m_options.regexp ? m_options.findText : FindPattern::escape(m_options.findText);
+
+      if (m_options.wholeWords) {
+         pattern = "\\b(?:" + pattern + ")\\b";
+      }
+
+      m_regExp = QRegularExpression(pattern);
+   }
+
+   if (m_options.matchCase) {
+      m_caseFlag = Qt::CaseSensitive;
+
+   } else {
+      m_caseFlag = Qt::CaseInsensitive;
+      m_regExp.setPatternOptions(QPatternOption::CaseInsensitiveOption);
+
+   }
+
+   if (TextSearch::canSearchBytes(m_options.findText, m_options.matchCase, m_options.wholeWords, m_options.regexp)) {
+      m_textSearch = new TextSearch(m_options.findText, m_options.matchCase, m_options.wholeWords);
+   }
+}
+
+AdvFindSearch::~AdvFindSearch()
+{
+   cancel();
+
+   // walker is stopped first so no new tasks are started
+   m_walkPool.waitForDone();
+   m_pool.waitForDone();
+
+   delete m_textSearch;
+}
+
+void AdvFindSearch::set_Index(TrigramIndex *index)
+{
+   m_index = index;
+}
+
+void AdvFindSearch::set_Model(AdvFindModel *model)
+{
+   m_model = model;
+}
+
+void AdvFindSearch::set_MaxFileSize(qint64 maxSize)
+{
+   m_maxFileSize = maxSize;
+}
+
+void AdvFindSearch::set_Replace(const QString &replaceText)
+{
+   m_isReplace   = true;
+   m_replaceText = replaceText;
+
+   // used when the text can not be replaced in the raw bytes, matches and expands the same as Replace
+   m_replacePattern = QSharedPointer<const FindPattern>(new FindPattern(m_options.findText, m_options.matchCase,
+         m_options.wholeWords, m_options.regexp));
+}
+
+void AdvFindSearch::start(const QString &folder, const QString &fileType, const QStringList &skipFolders,
+      bool subFolders)
+{
+   QStringList nameFilters(fileType);
+
+   m_walkPool.start(new AdvFindTask([this, folder, nameFilters, skipFolders, subFolders] ()
+         { walk(folder, nameFilters, skipFolders, subFolders); } ));
+}
+
+void AdvFindSearch::cancel()
+{
+   // queued tasks return without opening their file
+   m_canceled = true;
+}
+
+bool AdvFindSearch::isFinished() const
+{
+   return m_walkFinished && m_filesReceived == m_fileCount.load();
+}
+
+bool AdvFindSearch::isWalking() const
+{
+   return ! m_walkFinished;
+}
+
+int AdvFindSearch::get_FileCount() const
+{
+   return m_fileCount.load();
+}
+
+int AdvFindSearch::get_FilesDone() const
+{
+   return m_filesDone.load();
+}
+
+int AdvFindSearch::get_MatchCount() const
+{
+   return m_matchCount;
+}
+
+QVector<QSharedPointer<AdvReplaceFile>> AdvFindSearch::get_ReplaceFiles() const
+{
+   return m_replaceFiles;
+}
+
+QStringList AdvFindSearch::writeReplaceFiles(const QVector<QSharedPointer<AdvReplaceFile>> &fileList)
+{
+   QStringList errors;
+   QMutex errorMutex;
+
+   QThreadPool pool;
+
+   for (const auto &item : fileList) {
+      pool.start(new AdvFindTask([item, &errors, &errorMutex] () {
+         QString error = writeFile(*item);
+
+         if (! error.isEmpty()) {
+            QMutexLocker lock(&errorMutex);
+            errors.append(error);
+         }
+      } ));
+   }
+
+   pool.waitForDone();
+
+   return errors;
+}
+
+bool AdvFindSearch::event(QEvent *event)
+{
+   if (event->type() != AdvFindEvent::eventType()) {
+      return QObject::event(event);
+   }
+
+   QVector<AdvFindResult> pending;
+
+   {
+      QMutexLocker lock(&m_mutex);
+
+      pending.swap(m_pending);
+      m_eventPosted  = false;
+      m_walkFinished = m_walkDone;
+   }
+
+   for (auto &item : pending) {
+      ++m_filesReceived;
+
+      if (item.replaceFile.isNull()) {
+         m_matchCount += item.foundList.size();
+      } else {
+         m_matchCount += item.replaceFile->count;
+      }
+
+      m_waiting.insert(item.fileIndex, std::move(item));
+   }
+
+   // files finish out of order, results are passed on once all earlier files are done
+   QList<advFindStruct> ready;
+
+   while (! m_waiting.isEmpty() && m_waiting.firstKey() == m_nextFile) {
+      AdvFindResult item = m_waiting.take(m_nextFile);
+      ++m_nextFile;
+
+      ready.append(item.foundList);
+
+      if (! item.replaceFile.isNull()) {
+         m_replaceFiles.append(item.replaceFile);
+      }
+   }
+
+   if (m_model != nullptr) {
+      m_model->appendResults(ready);
+   }
+
+   return true;
+}
+
+void AdvFindSearch::postEvent()
+{
+   // called with m_mutex locked, one event is posted for everything finished before the GUI thread collects it
+   if (! m_eventPosted) {
+      m_eventPosted = true;
+      QCoreApplication::postEvent(this, new AdvFindEvent());
+   }
+}
+
+bool AdvFindSearch::isCandidate(const TrigramIndexData &indexData, const QBitArray &candidates, const QString &root,
+      const QString &name) const
+{
+   int id = indexData.fileId(TrigramIndex::relativePath(root, name));
+
+   if (id == -1 || candidates.testBit(id)) {
+      return true;
+   }
+
+   // skipped only when the file has not changed since it was indexed
+   const TrigramFile &entry = indexData.file(id);
+   QFileInfo info(name);
+
+   return info.size() != entry.size || info.lastModified().toMSecsSinceEpoch() != entry.modified;
+}
+
+void AdvFindSearch::walk(const QString &folder, const QStringList &nameFilters, const QStringList &skipFolders,
+      bool subFolders)
+{
+   QString root = folder;
+
+   QSharedPointer<const TrigramIndexData> indexData;
+   QBitArray candidates;
+
+   if (m_index != nullptr && m_textSearch != nullptr) {
+      // index only narrows literal searches, the files left are still searched
+      root      = TrigramIndex::rootPath(folder);
+      indexData = m_index->get_Index(root);
+
+      if (! indexData.isNull() && ! indexData->candidates(m_options.findText.toUtf8(), candidates)) {
+         indexData.reset();
+      }
+   }
+
+   // folders still to be listed, depth first
+   QStringList dirList;
+   dirList.append(root);
+
+   while (! dirList.isEmpty() && ! m_canceled) {
+      QString path = dirList.takeLast();
+
+      QStringList fileList;
+      QDirIterator fileIter(path, nameFilters, QDir::Files | QDir::NoSymLinks);
+
+      while (fileIter.hasNext()) {
+         fileList.append(fileIter.next());
+      }
+
+      fileList.sort();
+
+      for (QString &name : fileList) {
+
+         if (m_canceled) {
+            break;
+         }
+
+         if (! indexData.isNull() && ! isCandidate(*indexData, candidates, root, name)) {
+            continue;
+         }
+
+#if defined (Q_OS_WIN)
+         // change forward to backslash
+         name.replace('/', '\\');
+#endif
+
+         // wait while the workers are behind, released when a file has been searched
+         m_queue.acquire();
+
+         int index = m_fileCount++;
+         m_pool.start(new AdvFindTask([this, index, name] () { searchFile(index, name); } ));
+      }
+
+      if (subFolders) {
+         QStringList subList;
+         QDirIterator dirIter(path, QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+
+         while (dirIter.hasNext()) {
+            dirIter.next();
+
+            if (! skipFolders.contains(dirIter.fileName())) {
+               subList.append(dirIter.filePath());
+            }
+         }
+
+         subList.sort();
+
+         for (int k = subList.size() - 1; k >= 0; --k) {
+            dirList.append(subList[k]);
+         }
+      }
+   }
+
+   QMutexLocker lock(&m_mutex);
+   m_walkDone = true;
+
+   postEvent();
+}
+
+void AdvFindSearch::searchFile(int index, const QString &name)
+{
+   AdvFindResult result;
+   result.fileIndex = index;
+
+   QList<advFindStruct> &foundList = result.foundList;
+
+   if (! m_canceled) {
+      QFile file(name);
+
+      if (file.open(QIODevice::ReadOnly) && isSearchable(file)) {
+
+         // the pattern is UTF-8, QTextStream decodes UTF-16 from the byte order mark
+         QByteArray head = file.peek(2);
+         bool isUtf16    = TextSearch::isUtf16(head.constData(), head.size());
+
+         if (m_isReplace) {
+            result.replaceFile = replaceFile(file, name);
+
+         } else if (m_textSearch != nullptr && ! isUtf16) {
+            searchBytes(file, name, foundList);
+         } else {
+            searchLines(file, name, foundList);
+         }
+
+         file.close();
+      }
+   }
+
+   ++m_filesDone;
+   m_queue.release();
+
+   QMutexLocker lock(&m_mutex);
+   m_pending.append(std::move(result));
+
+   postEvent();
+}
+
+bool AdvFindSearch::isSearchable(QFile &file) const
+{
+   if (m_maxFileSize > 0 && file.size() > m_maxFileSize) {
+      return false;
+   }
+
+   // binary files are rejected before any text is decoded, peek does not move the file position
+   QByteArray head = file.peek(SNIFF_SIZE);
+
+   return TextSearch::isText(head.constData(), head.size());
+}
+
+void AdvFindSearch::searchBytes(QFile &file, const QString &name, QList<advFindStruct> &foundList)
+{
+   qint64 size = file.size();
+
+   if (size == 0) {
+      return;
+   }
+
+   // file is mapped, a file with no match is scanned once and never decoded
+   QByteArray buffer;
+   const char *data = mapFile(file, buffer, size);
+
+   // skip the byte order mark
+   qint64 begin = hasByteOrderMark(data, size) ? 3 : 0;
+
+   // line numbers are only counted up to each match
+   int lineNumber = 1;
+   qint64 counted = begin;
+   qint64 pos     = begin;
+
+   while (pos < size && ! m_canceled) {
+      qint64 found = m_textSearch->indexIn(data, size, pos);
+
+      if (found == -1) {
+         break;
+      }
+
+      lineNumber += std::count(data + counted, data + found, '\n');
+      counted = found;
+
+      qint64 lineStart = found;
+
+      while (lineStart > begin && data[lineStart - 1] != '\n') {
+         --lineStart;
+      }
+
+      const char *eol = static_cast<const char *>(std::memchr(data + found, '\n', size - found));
+      qint64 lineEnd  = (eol == nullptr) ? size : (eol - data);
+
+      advFindStruct temp;
+
+      temp.fileName   = name;
+      temp.lineNumber = lineNumber;
+      temp.text       = QString::fromUtf8(data + lineStart, lineEnd - lineStart).trimmed();
+
+      foundList.append(temp);
+
+      // one entry per line
+      pos = lineEnd + 1;
+   }
+}
+
+void AdvFindSearch::searchLines(QFile &file, const QString &name, QList<advFindStruct> &foundList)
+{
+   QString line;
+   QTextStream in(&file);
+
+   int lineNumber = 0;
+   int position   = 0;
+
+   while (! in.atEnd()) {
+
+      if (m_canceled) {
+         break;
+      }
+
+      line = in.readLine();
+      ++lineNumber;
+
+      if (m_options.wholeWords || m_options.regexp)  {
+         position = line.indexOf(m_regExp);
+
+      } else  {
+         position = line.indexOf(m_options.findText, 0, m_caseFlag);
+
+      }
+
+      // store the results
+      if (position != -1)  {
+         advFindStruct temp;
+
+         temp.fileName   = name;
+         temp.lineNumber = lineNumber;
+         temp.text       = line.trimmed();
+
+         foundList.append(temp);
+      }
+   }
+}
+
+QSharedPointer<AdvReplaceFile> AdvFindSearch::replaceFile(QFile &file, const QString &name)
+{
+   QSharedPointer<AdvReplaceFile> result = QSharedPointer<AdvReplaceFile>::create();
+
+   QFileInfo info(file);
+
+   result->fileName = name;
+   result->size     = info.size();
+   result->modified = info.lastModified().toMSecsSinceEpoch();
+   result->valid    = true;
+   result->count    = 0;
+
+   qint64 size = file.size();
+
+   if (size == 0) {
+      return QSharedPointer<AdvReplaceFile>();
+   }
+
+   QByteArray buffer;
+   const char *data = mapFile(file, buffer, size);
+
+   if (m_textSearch != nullptr) {
+      result->count = replaceBytes(data, size, *result);
+   } else {
+      result->count = replaceLines(data, size, *result);
+   }
+
+   if (result->count == 0 || m_canceled) {
+      return QSharedPointer<AdvReplaceFile>();
+   }
+
+   return result;
+}
+
+int AdvFindSearch::replaceBytes(const char *data, qint64 size, AdvReplaceFile &result)
+{
+   // text between the matches is copied without decoding it, line endings and encoding are kept
+   const QByteArray replacement = m_replaceText.toUtf8();
+   const int length = m_textSearch->length();
+
+   qint64 begin = hasByteOrderMark(data, size) ? 3 : 0;
+
+   int count      = 0;
+   int lineNumber = 1;
+
+   qint64 counted = begin;
+   qint64 copied  = 0;
+   qint64 pos     = begin;
+
+   while (pos < size && ! m_canceled) {
+      qint64 found = m_textSearch->indexIn(data, size, pos);
+
+      if (found == -1) {
+         break;
+      }
+
+      lineNumber += std::count(data + counted, data + found, '\n');
+      counted = found;
+
+      qint64 lineStart = found;
+
+      while (lineStart > begin && data[lineStart - 1] != '\n') {
+         --lineStart;
+      }
+
+      const char *eol = static_cast<const char *>(std::memchr(data + found, '\n', size - found));
+      qint64 lineEnd  = (eol == nullptr) ? size : (eol - data);
+
+      // every match on this line, the pattern never contains a line break
+      QByteArray newLine;
+      qint64 linePos = lineStart;
+
+      while (found != -1 && found < lineEnd) {
+         newLine.append(data + linePos, found - linePos);
+         newLine.append(replacement);
+
+         linePos = found + length;
+         ++count;
+
+         found = m_textSearch->indexIn(data, lineEnd, linePos);
+      }
+
+      newLine.append(data + linePos, lineEnd - linePos);
+
+      result.newContents.append(data + copied, lineStart - copied);
+      result.newContents.append(newLine);
+      copied = lineEnd;
+
+      AdvReplaceLine line;
+      line.lineNumber = lineNumber;
+      line.oldText    = QString::fromUtf8(data + lineStart, lineEnd - lineStart).trimmed();
+      line.newText    = QString::fromUtf8(newLine).trimmed();
+
+      result.lines.append(line);
+
+      pos = lineEnd + 1;
+   }
+
+   if (count != 0) {
+      result.newContents.append(data + copied, size - copied);
+   }
+
+   return count;
+}
+
+int AdvFindSearch::replaceLines(const char *data, qint64 size, AdvReplaceFile &result)
+{
+   qint64 begin = hasByteOrderMark(data, size) ? 3 : 0;
+
+   QByteArray bytes = QByteArray::fromRawData(data + begin, size - begin);
+   QString text     = QString::fromUtf8(bytes);
+
+   // a replacement character which was not in the file means the file is not UTF-8
+   if (text.contains(QChar(0xFFFD)) && ! bytes.contains("\xEF\xBF\xBD")) {
+      result.valid = false;
+   }
+
+   QStringList lineList = text.split("\n");
+
+   int count = 0;
+
+   for (int k = 0; k < lineList.size() && ! m_canceled; ++k) {
+      const QString &oldLine = lineList[k];
+
+      // empty matches are skipped, only text which is replaced is counted
+      QVector<FindMatch> matchList = m_replacePattern->replaceAll(oldLine, 0, m_replaceText);
+
+      if (matchList.isEmpty()) {
+         continue;
+      }
+
+      QString newLine;
+      int copied = 0;
+
+      for (const FindMatch &item : matchList) {
+         newLine += oldLine.mid(copied, item.start - copied) + item.newText;
+         copied   = item.start + item.length;
+      }
+
+      newLine += oldLine.mid(copied);
+
+      AdvReplaceLine line;
+      line.lineNumber = k + 1;
+      line.oldText    = oldLine.trimmed();
+      line.newText    = newLine.trimmed();
+
+      result.lines.append(line);
+
+      lineList[k] = newLine;
+      count += matchList.size();
+   }
+
+   if (count != 0 && result.valid) {
+      result.newContents = QByteArray(data, begin) + lineList.join("\n").toUtf8();
+   }
+
+   return count;
+}
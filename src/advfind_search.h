@@ -0,0 +1,196 @@
+/**************************************************************************
+*
+* Copyright (c) 2012-2025 Barbara Geller
+*
+* Diamond Editor is free software. You can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Diamond Editor is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* https://www.gnu.org/licenses/
+*
+***************************************************************************/
+
+#ifndef ADVFIND_SEARCH_H
+#define ADVFIND_SEARCH_H
+
+#include "find_pattern.h"
+#include "text_search.h"
+#include "trigram_index.h"
+
+#include <QEvent>
+#include <QFile>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QRegularExpression>
+#include <QSemaphore>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+#include <atomic>
+
+struct advFindStruct
+{
+   QString fileName;
+   int lineNumber;
+   QString text;
+};
+
+struct AdvFindOptions
+{
+   QString findText;
+   bool matchCase  = false;
+   bool wholeWords = false;
+   bool regexp     = false;
+};
+
+struct AdvReplaceLine
+{
+   int lineNumber;
+   QString oldText;
+   QString newText;
+};
+
+// new contents of one file for Replace in Files
+struct AdvReplaceFile
+{
+   QString fileName;
+
+   // when the replacement was computed, the file is not written if it changed since
+   qint64 size;
+   qint64 modified;
+
+   // false when the file is not valid UTF-8 and can not be written without changing other text
+   bool valid;
+
+   int count;
+   QByteArray newContents;
+   QVector<AdvReplaceLine> lines;
+};
+
+// results for one file, passed from a worker to the GUI thread
+struct AdvFindResult
+{
+   int fileIndex;
+   QList<advFindStruct> foundList;
+   QSharedPointer<AdvReplaceFile> replaceFile;
+};
+
+class AdvFindModel;
+
+// posted to the search object when files have been searched, results are collected in batches
+class AdvFindEvent : public QEvent
+{
+   public:
+      AdvFindEvent()
+         : QEvent(eventType())
+      { }
+
+      static QEvent::Type eventType();
+};
+
+// walks a folder on one thread and searches each file found on a thread pool, one file per task
+class AdvFindSearch : public QObject
+{
+   CS_OBJECT(AdvFindSearch)
+
+   public:
+      AdvFindSearch(const AdvFindOptions &options);
+      ~AdvFindSearch();
+
+      // files which can not contain the text are skipped, must be called before start()
+      void set_Index(TrigramIndex *index);
+
+      // results are appended to the model in the order the files were listed
+      void set_Model(AdvFindModel *model);
+
+      // larger files are not searched, 0 for no limit
+      void set_MaxFileSize(qint64 maxSize);
+
+      // computes the new contents of each file instead of listing the matches, must be called before start()
+      // captured text is inserted with \1 to \9 when searching with a regular expression, the same as Replace
+      void set_Replace(const QString &replaceText);
+
+      // folders in skipFolders are not entered, matched by name at any depth
+      void start(const QString &folder, const QString &fileType, const QStringList &skipFolders, bool subFolders);
+      void cancel();
+
+      bool isFinished() const;
+      bool isWalking() const;
+      int get_FileCount() const;
+      int get_FilesDone() const;
+      int get_MatchCount() const;
+
+      // files with at least one replacement, in the order the files were listed
+      QVector<QSharedPointer<AdvReplaceFile>> get_ReplaceFiles() const;
+
+      // each file is written to a temporary file which is renamed over the original, returns the errors
+      static QStringList writeReplaceFiles(const QVector<QSharedPointer<AdvReplaceFile>> &fileList);
+
+   protected:
+      bool event(QEvent *event) override;
+
+   private:
+      void walk(const QString &folder, const QStringList &nameFilters, const QStringList &skipFolders, bool subFolders);
+      void searchFile(int index, const QString &name);
+      bool isSearchable(QFile &file) const;
+      bool isCandidate(const TrigramIndexData &indexData, const QBitArray &candidates, const QString &root,
+            const QString &name) const;
+      void postEvent();
+      void searchBytes(QFile &file, const QString &name, QList<advFindStruct> &foundList);
+      void searchLines(QFile &file, const QString &name, QList<advFindStruct> &foundList);
+      QSharedPointer<AdvReplaceFile> replaceFile(QFile &file, const QString &name);
+      int replaceBytes(const char *data, qint64 size, AdvReplaceFile &result);
+      int replaceLines(const char *data, qint64 size, AdvReplaceFile &result);
+
+      AdvFindOptions m_options;
+      QRegularExpression m_regExp;
+      Qt::CaseSensitivity m_caseFlag;
+
+      // nullptr when the text has to be decoded to search it
+      TextSearch *m_textSearch;
+
+      qint64 m_maxFileSize;
+
+      bool m_isReplace;
+      QString m_replaceText;
+      QSharedPointer<const FindPattern> m_replacePattern;
+
+      // optional, owned by the main window
+      TrigramIndex *m_index;
+      AdvFindModel *m_model;
+
+      // written by the walker and the workers, taken by the GUI thread when an AdvFindEvent arrives
+      QMutex m_mutex;
+      QVector<AdvFindResult> m_pending;
+      bool m_eventPosted;
+      bool m_walkDone;
+
+      std::atomic<bool> m_canceled;
+      std::atomic<int> m_fileCount;
+      std::atomic<int> m_filesDone;
+
+      // limits the number of files listed but not yet searched
+      QSemaphore m_queue;
+
+      // only accessed on the GUI thread, results of files finished ahead of m_nextFile
+      QMap<int, AdvFindResult> m_waiting;
+      QVector<QSharedPointer<AdvReplaceFile>> m_replaceFiles;
+      int m_nextFile;
+      int m_matchCount;
+      int m_filesReceived;
+      bool m_walkFinished;
+
+      QThreadPool m_walkPool;
+      QThreadPool m_pool;
+};
+
+#endif
@@ -22,26 +22,36 @@
 
 QStringList Dialog_AdvFind::dirCombo;
 
-Dialog_AdvFind::Dialog_AdvFind(MainWindow *parent, QString findText, QString fileType, QString findFolder,
-      bool searchFolders, bool matchCase, bool wholeWords, bool regexp)
+Dialog_AdvFind::Dialog_AdvFind(MainWindow *parent, QString findText, QString replaceText, QString fileType,
+      QString findFolder, QString skipFolders, int maxSize, bool searchFolders, bool useIndex, bool matchCase,
+      bool wholeWords, bool regexp)
    : QDialog(parent), m_ui(new Ui::Dialog_AdvFind)
 {
    m_parent  = parent;
-   m_busyMsg = nullptr;
+   m_busyMsg   = nullptr;
+   m_isReplace = false;
 
    m_ui->setupUi(this);
    setWindowIcon(QIcon("://resources/diamond.png"));
 
    m_ui->find->setText(findText);
+   m_ui->replace->setText(replaceText);
    m_ui->findType->setText(fileType);
 
    m_ui->findFolder->insertItems(0, dirCombo);
    m_ui->findFolder->setEditText(findFolder);
 
+   m_ui->skipFolders->setText(skipFolders);
+   m_ui->maxSize_SB->setValue(maxSize);
+
    if (searchFolders) {
       m_ui->searchSubFolders_CKB->setChecked(true);
    }
 
+   if (useIndex) {
+      m_ui->useIndex_CKB->setChecked(true);
+   }
+
    if (matchCase) {
       m_ui->matchCase_CKB->setChecked(true);
    }
@@ -55,8 +65,9 @@ Dialog_AdvFind::Dialog_AdvFind(MainWindow *parent, QString findText, QString fil
    }
 
    connect(m_ui->folder_TB, &QToolButton::clicked, this, &Dialog_AdvFind::pick_Folder);
-   connect(m_ui->find_PB,   &QPushButton::clicked, this, &Dialog_AdvFind::find);
-   connect(m_ui->cancel_PB, &QPushButton::clicked, this, &Dialog_AdvFind::cancel);
+   connect(m_ui->find_PB,    &QPushButton::clicked, this, &Dialog_AdvFind::find);
+   connect(m_ui->replace_PB, &QPushButton::clicked, this, &Dialog_AdvFind::replace);
+   connect(m_ui->cancel_PB,  &QPushButton::clicked, this, &Dialog_AdvFind::cancel);
 }
 
 Dialog_AdvFind::~Dialog_AdvFind()
@@ -89,11 +100,13 @@ void Dialog_AdvFind::showBusyMsg()
 {
    m_ui->find_PB->setVisible(false);
    m_ui->horizontalSpacer_32->changeSize(0,0);
+   m_ui->replace_PB->setVisible(false);
+   m_ui->horizontalSpacer_34->changeSize(0,0);
    m_ui->cancel_PB->setVisible(false);
 
    if (m_busyMsg == nullptr)   {
       m_busyMsg = new QLabel();
-      m_busyMsg->setText("Preparing list of files, this process may take a minute...");
+      m_busyMsg->setText("Searching files, this process may take a minute...");
 
       QFont font = m_busyMsg->font();
       font.setPointSize(10);
@@ -125,6 +138,8 @@ void Dialog_AdvFind::showNotBusyMsg()
 
    m_ui->find_PB->setVisible(true);
    m_ui->horizontalSpacer_32->changeSize(8,25);
+   m_ui->replace_PB->setVisible(true);
+   m_ui->horizontalSpacer_34->changeSize(8,25);
    m_ui->cancel_PB->setVisible(true);
 
    QApplication::processEvents();
@@ -137,6 +152,8 @@ void Dialog_AdvFind::cancel()
 
 void Dialog_AdvFind::find()
 {
+   m_isReplace = false;
+
    QString tmp = m_ui->findFolder->currentText();
 
    if (! dirCombo.contains(tmp)) {
@@ -146,11 +163,23 @@ void Dialog_AdvFind::find()
    done(1);
 }
 
+void Dialog_AdvFind::replace()
+{
+   // same search as find, changes are shown before any file is written
+   find();
+   m_isReplace = true;
+}
+
 QString Dialog_AdvFind::get_findText()
 {
    return m_ui->find->text();
 }
 
+QString Dialog_AdvFind::get_replaceText()
+{
+   return m_ui->replace->text();
+}
+
 QString Dialog_AdvFind::get_findType()
 {
    return m_ui->findType->text();
@@ -161,6 +190,16 @@ QString Dialog_AdvFind::get_findFolder()
    return m_ui->findFolder->currentText();
 }
 
+QString Dialog_AdvFind::get_skipFolders()
+{
+   return m_ui->skipFolders->text();
+}
+
+int Dialog_AdvFind::get_MaxSize()
+{
+   return m_ui->maxSize_SB->value();
+}
+
 bool Dialog_AdvFind::get_MatchCase()
 {
    return m_ui->matchCase_CKB->isChecked();
@@ -181,3 +220,12 @@ bool Dialog_AdvFind::get_SearchSubFolders()
    return m_ui->searchSubFolders_CKB->isChecked();
 }
 
+bool Dialog_AdvFind::get_UseIndex()
+{
+   return m_ui->useIndex_CKB->isChecked();
+}
+
+bool Dialog_AdvFind::get_IsReplace()
+{
+   return m_isReplace;
+}
@@ -29,30 +29,40 @@ class Dialog_AdvFind : public QDialog
    CS_OBJECT(Dialog_AdvFind)
 
    public:
-      Dialog_AdvFind(MainWindow *parent, QString text, QString fileType, QString findFolder, bool searchFolders,
-         bool matchCase, bool wholeWords, bool regexp);
+      Dialog_AdvFind(MainWindow *parent, QString text, QString replaceText, QString fileType, QString findFolder,
+         QString skipFolders, int maxSize, bool searchFolders, bool useIndex, bool matchCase, bool wholeWords,
+         bool regexp);
       ~Dialog_AdvFind();
 
       QString get_findText();
+      QString get_replaceText();
       QString get_findType();
       QString get_findFolder();
+      QString get_skipFolders();
+      int get_MaxSize();
 
       bool get_MatchCase();
       bool get_WholeWords();
       bool get_Regexp();
 
       bool get_SearchSubFolders();
+      bool get_UseIndex();
+
+      // true when the dialog was closed with the Replace button
+      bool get_IsReplace();
       void showBusyMsg();
       void showNotBusyMsg();
 
    private:
       void pick_Folder();
       void find();
+      void replace();
       void cancel();
 
       Ui::Dialog_AdvFind *m_ui;
       MainWindow *m_parent;
       QLabel *m_busyMsg;
+      bool m_isReplace;
 
       static QStringList dirCombo;
 };
@@ -137,6 +137,11 @@ bool Dialog_Find::get_WholeWords()
    return m_ui->wholeWords_CKB->isChecked();
 }
 
+bool Dialog_Find::get_Regexp()
+{
+   return m_ui->regexp_CKB->isChecked();
+}
+
 bool Dialog_Find::get_Upd_Find()
 {
    return m_upd_Find;
@@ -38,6 +38,7 @@ class Dialog_Find : public QDialog
       bool get_Direction();
       bool get_MatchCase();
       bool get_WholeWords();
+      bool get_Regexp();
       bool get_Upd_Find();
 
    private:
@@ -97,6 +97,10 @@ void Dialog_Options::initData()
       m_ui->autoLoad_CKB->setChecked(true);
    }
 
+   if (m_options.spellComments)  {
+      m_ui->spellComments_CKB->setChecked(true);
+   }
+
    m_ui->dictMain->setText(m_options.dictMain);
    m_ui->dictMain->setCursorPosition(0);
 
@@ -208,6 +212,7 @@ struct Options Dialog_Options::get_Results()
    m_options.useSpaces   = m_ui->useSpaces_CKB->isChecked();
    m_options.removeSpace = m_ui->removeSpace_CKB->isChecked();
    m_options.autoLoad    = m_ui->autoLoad_CKB->isChecked();
+   m_options.spellComments = m_ui->spellComments_CKB->isChecked();
 
    // ** tab 2
    m_options.key_open         = m_ui->key_open->text();
@@ -180,6 +180,11 @@ bool Dialog_Replace::get_WholeWords()
    return m_ui->wholeWords_CKB->isChecked();
 }
 
+bool Dialog_Replace::get_Regexp()
+{
+   return m_ui->regexp_CKB->isChecked();
+}
+
 bool Dialog_Replace::get_Upd_Find()
 {
    return m_upd_Find;
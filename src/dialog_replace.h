@@ -41,6 +41,7 @@ class Dialog_Replace : public QDialog
 
       bool get_MatchCase();
       bool get_WholeWords();
+      bool get_Regexp();
       bool get_Upd_Find();
       bool get_Upd_Replace();
 
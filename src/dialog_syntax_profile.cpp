@@ -0,0 +1,115 @@
+/**************************************************************************
+*
+* Copyright (c) 2012-2025 Barbara Geller
+*
+* Diamond Editor is free software. You can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Diamond Editor is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* https://www.gnu.org/licenses/
+*
+***************************************************************************/
+
+
+#include "dialog_syntax_profile.h"
+#include "syntax_profiler.h"
+#include "util.h"
+
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QHeaderView>
+
+Dialog_SyntaxProfile::Dialog_SyntaxProfile(QWidget *parent, SpellCheck *spell)
+   : QDialog(parent), m_ui(new Ui::Dialog_SyntaxProfile), m_spellCheck(spell)
+{
+   m_ui->setupUi(this);
+   setWindowIcon(QIcon("://resources/diamond.png"));
+
+   m_model = new QStandardItemModel(this);
+   m_model->setHorizontalHeaderLabels(QStringList() << tr("Syntax File") << tr("Group") << tr("Rule")
+         << tr("Invocations") << tr("Skipped") << tr("Matches") << tr("Total ms") << tr("Avg us"));
+
+   m_ui->profileTable->setModel(m_model);
+   m_ui->profileTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+   m_ui->profileTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+   m_ui->profileTable->horizontalHeader()->setStretchLastSection(true);
+   m_ui->profileTable->verticalHeader()->hide();
+
+   m_ui->enable_CKB->setChecked(SyntaxProfiler::isEnabled());
+
+   refresh();
+
+   connect(m_ui->enable_CKB,  &QCheckBox::toggled,    this, &Dialog_SyntaxProfile::enable);
+   connect(m_ui->refresh_PB,  &QPushButton::clicked,  this, &Dialog_SyntaxProfile::refresh);
+   connect(m_ui->reset_PB,    &QPushButton::clicked,  this, &Dialog_SyntaxProfile::reset);
+   connect(m_ui->save_PB,     &QPushButton::clicked,  this, &Dialog_SyntaxProfile::save);
+   connect(m_ui->close_PB,    &QPushButton::clicked,  this, &Dialog_SyntaxProfile::accept);
+}
+
+Dialog_SyntaxProfile::~Dialog_SyntaxProfile()
+{
+   delete m_ui;
+}
+
+void Dialog_SyntaxProfile::refresh()
+{
+   m_model->removeRows(0, m_model->rowCount());
+
+   const QVector<SyntaxProfileEntry> list = SyntaxProfiler::entries();
+
+   for (int row = 0; row < list.size(); ++row) {
+      const SyntaxProfileEntry &entry = list[row];
+
+      double totalMs = entry.nsecs / 1000000.0;
+      double avgUs   = entry.invocations > 0 ? (entry.nsecs / 1000.0) / entry.invocations : 0.0;
+
+      m_model->setItem(row, 0, new QStandardItem(QFileInfo(entry.fileName).fileName()));
+      m_model->setItem(row, 1, new QStandardItem(SyntaxProfiler::formatName(entry.format)));
+      m_model->setItem(row, 2, new QStandardItem(entry.rule));
+      m_model->setItem(row, 3, new QStandardItem(QString::number(entry.invocations)));
+      m_model->setItem(row, 4, new QStandardItem(QString::number(entry.skipped)));
+      m_model->setItem(row, 5, new QStandardItem(QString::number(entry.matches)));
+      m_model->setItem(row, 6, new QStandardItem(QString::number(totalMs, 'f', 3)));
+      m_model->setItem(row, 7, new QStandardItem(QString::number(avgUs, 'f', 2)));
+   }
+
+   m_ui->profileTable->resizeColumnsToContents();
+
+   if (m_spellCheck != nullptr) {
+      qint64 hits   = m_spellCheck->get_CacheHits();
+      qint64 misses = m_spellCheck->get_CacheMisses();
+      double rate   = (hits + misses) > 0 ? (100.0 * hits) / (hits + misses) : 0.0;
+
+      m_ui->spellCache_Label->setText(tr("Spell check cache: %1 hits, %2 misses (%3% hit rate)")
+            .formatArgs(QString::number(hits), QString::number(misses), QString::number(rate, 'f', 1)));
+   }
+}
+
+void Dialog_SyntaxProfile::reset()
+{
+   SyntaxProfiler::clear();
+   refresh();
+}
+
+void Dialog_SyntaxProfile::save()
+{
+   QString fileName = QFileDialog::getSaveFileName(this, tr("Save Syntax Profile"),
+         "syntax_profile.json", tr("Json Files (*.json)"));
+
+   if (fileName.isEmpty()) {
+      return;
+   }
+
+   if (! SyntaxProfiler::writeJson(fileName)) {
+      csError(tr("Syntax Profile"), tr("Unable to save file: ") + fileName);
+   }
+}
+
+void Dialog_SyntaxProfile::enable(bool value)
+{
+   SyntaxProfiler::setEnabled(value);
+}
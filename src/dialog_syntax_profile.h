@@ -0,0 +1,46 @@
+/**************************************************************************
+*
+* Copyright (c) 2012-2025 Barbara Geller
+*
+* Diamond Editor is free software. You can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Diamond Editor is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* https://www.gnu.org/licenses/
+*
+***************************************************************************/
+
+
+#ifndef DIALOG_SYNTAX_PROFILE_H
+#define DIALOG_SYNTAX_PROFILE_H
+
+#include "spellcheck.h"
+#include "ui_dialog_syntax_profile.h"
+
+#include <QDialog>
+#include <QStandardItemModel>
+
+class Dialog_SyntaxProfile : public QDialog
+{
+   CS_OBJECT(Dialog_SyntaxProfile)
+
+   public:
+      Dialog_SyntaxProfile(QWidget *parent, SpellCheck *spell);
+      ~Dialog_SyntaxProfile();
+
+   private:
+      void refresh();
+      void reset();
+      void save();
+      void enable(bool value);
+
+      Ui::Dialog_SyntaxProfile *m_ui;
+      QStandardItemModel *m_model;
+      SpellCheck *m_spellCheck;
+};
+
+#endif
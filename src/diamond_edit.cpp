@@ -24,6 +24,21 @@
 
 const QColor FILL_COLOR = QColor(0xD0D0D0);
 
+// every match of the find text in the viewport
+const QColor MATCH_TEXT_COLOR = QColor(Qt::black);
+const QColor MATCH_BACK_COLOR = QColor(0xFFE680);
+
+// time the cursor rests on a word before suggestions are prefetched (ms)
+static constexpr const int SUGGEST_DELAY = 400;
+
+// extra selections which are part of a column mode selection
+static bool isColumnSelection(const QTextEdit::ExtraSelection &selection)
+{
+   QString property = selection.format.property(QTextFormat::UserProperty).toString();
+
+   return property != "highlightbar" && property != "findmatch";
+}
+
 DiamondTextEdit::DiamondTextEdit(MainWindow *from, struct Settings settings, SpellCheck *spell, QString owner)
       : QPlainTextEdit()
 {
@@ -51,13 +66,36 @@ DiamondTextEdit::DiamondTextEdit(MainWindow *from, struct Settings settings, Spe
    m_spellCheck   = spell;
    m_isSpellCheck = settings.isSpellCheck;
 
+   m_suggestMenu   = nullptr;
+   m_suggestAction = nullptr;
+
+   // find highlights, created on first use
+   m_findIndex  = nullptr;
+   m_matchFirst = -1;
+   m_matchLast  = -1;
+
    // line highlight bar
    connect(this, &DiamondTextEdit::blockCountChanged, this, &DiamondTextEdit::update_LineNumWidth);
    connect(this, &DiamondTextEdit::updateRequest,     this, &DiamondTextEdit::update_LineNumArea);
+
+   // syntax highlighting starts with the visible blocks
+   connect(this, &DiamondTextEdit::updateRequest, this, [this](){ update_SyntaxViewport(); } );
+   connect(this, &DiamondTextEdit::updateRequest, this, [this](){ update_MatchSelections(false); } );
+
+   // suggestions are prefetched when the cursor rests on a misspelled word
+   m_suggestTimer.setSingleShot(true);
+
+   connect(&m_suggestTimer, &QTimer::timeout, this, [this](){ prefetch_Suggestions(); } );
+   connect(this, &DiamondTextEdit::cursorPositionChanged, this, [this](){ m_suggestTimer.start(SUGGEST_DELAY); } );
 }
 
 DiamondTextEdit::~DiamondTextEdit()
 {
+   if (m_spellCheck != nullptr) {
+      m_spellCheck->cancelSuggest(this);
+   }
+
+   delete m_findIndex;
 }
 
 // ** line numbers
@@ -157,7 +195,7 @@ void DiamondTextEdit::contextMenuEvent(QContextMenuEvent *event)
 
       for (int k = 0; k < oldSelections.size(); ++k) {
 
-         if (oldSelections[k].format.property(QTextFormat::UserProperty).toString() != "highlightbar") {
+         if (isColumnSelection(oldSelections[k])) {
             isSelected = true;
             break;
          }
@@ -176,16 +214,37 @@ void DiamondTextEdit::contextMenuEvent(QContextMenuEvent *event)
       // set up to save words, used in add_userDict() and replaceWord()
       m_cursor = cursor;
 
-      QStringList m_maybeList = m_mainWindow->spell_getMaybe(selectedText);
-      int cnt = m_maybeList.count();
+      QStringList maybeList;
+
+      // the dictionary is only on the worker thread, use the words the spell check underlined
+      bool isMisspelled = m_syntaxParser != nullptr
+            && m_syntaxParser->isMisspelled(cursor.block(), cursor.selectionStart() - cursor.block().position());
 
-      if (cnt > 0)  {
-         for (int k = 0; k < cnt; ++k)  {
-            menu->addAction(m_maybeList[k], m_mainWindow, SLOT(spell_replaceWord())  );
+      if (selectedText.isEmpty() || ! isMisspelled) {
+         // correct or not checked yet, no suggestions
+
+      } else if (m_spellCheck->get_Suggestions(selectedText, maybeList)) {
+         // prefetched or used before
+         if (! maybeList.isEmpty())  {
+            for (const auto &item : maybeList)  {
+               menu->addAction(item, m_mainWindow, SLOT(spell_replaceWord())  );
+            }
+
+            menu->addAction("Add to User Dictionary", m_mainWindow, SLOT(spell_addUserDict()) );
+            menu->addSeparator();
          }
 
+      } else {
+         // menu opens now, the suggestions are added when the worker thread has them
+         m_suggestMenu   = menu;
+         m_suggestWord   = selectedText;
+         m_suggestAction = menu->addAction("Looking up suggestions...");
+         m_suggestAction->setEnabled(false);
+
          menu->addAction("Add to User Dictionary", m_mainWindow, SLOT(spell_addUserDict()) );
          menu->addSeparator();
+
+         m_spellCheck->suggestAsync(selectedText, this);
       }
    }
 
@@ -240,6 +299,10 @@ void DiamondTextEdit::contextMenuEvent(QContextMenuEvent *event)
    }
 
    menu->exec(event->globalPos());
+
+   m_suggestMenu   = nullptr;
+   m_suggestAction = nullptr;
+
    delete menu;
 }
 
@@ -262,6 +325,116 @@ Syntax * DiamondTextEdit::get_SyntaxParser()
 void DiamondTextEdit::set_SyntaxParser(Syntax *parser)
 {
    m_syntaxParser = parser;
+   update_SyntaxViewport();
+}
+
+QTextBlock DiamondTextEdit::lastVisibleBlock()
+{
+   QTextBlock block = firstVisibleBlock();
+   QTextBlock last  = block;
+
+   int bottom = viewport()->rect().bottom();
+   int top    = (int) blockBoundingGeometry(block).translated(contentOffset()).top();
+
+   while (block.isValid() && top <= bottom) {
+      last  = block;
+      top  += (int) blockBoundingRect(block).height();
+      block = block.next();
+   }
+
+   return last;
+}
+
+void DiamondTextEdit::update_SyntaxViewport()
+{
+   if (m_syntaxParser == nullptr) {
+      return;
+   }
+
+   m_syntaxParser->set_VisibleBlocks(firstVisibleBlock().blockNumber(), lastVisibleBlock().blockNumber());
+}
+
+// ** find highlights
+FindIndex *DiamondTextEdit::get_FindIndex(bool create)
+{
+   // the split window shares the document of another tab
+   if (m_findIndex != nullptr && m_findIndex->get_Document() != document()) {
+      delete m_findIndex;
+      m_findIndex = nullptr;
+   }
+
+   if (m_findIndex == nullptr && create) {
+      m_findIndex = new FindIndex(document());
+      connect(m_findIndex, &FindIndex::matchesChanged, this, [this](){ update_MatchSelections(true); } );
+      connect(m_findIndex, &FindIndex::matchesChanged, this, &DiamondTextEdit::findMatchesChanged);
+   }
+
+   return m_findIndex;
+}
+
+QList<QTextEdit::ExtraSelection> DiamondTextEdit::get_MatchSelections()
+{
+   return m_matchSelections;
+}
+
+void DiamondTextEdit::update_MatchSelections(bool force)
+{
+   if (m_findIndex == nullptr) {
+      return;
+   }
+
+   QTextBlock block = lastVisibleBlock();
+
+   int first = firstVisibleBlock().position();
+   int last  = block.position() + block.length();
+
+   // updateRequest is also sent for the cursor and for setExtraSelections()
+   if (! force && first == m_matchFirst && last == m_matchLast) {
+      return;
+   }
+
+   m_matchFirst = first;
+   m_matchLast  = last;
+
+   // only the matches in the viewport are drawn
+   QList<QTextEdit::ExtraSelection> matchList;
+
+   int index = m_findIndex->nextMatch(first);
+   int count = m_findIndex->get_MatchCount();
+
+   while (index != -1 && index < count && m_findIndex->get_MatchStart(index) < last) {
+      int start = m_findIndex->get_MatchStart(index);
+
+      QTextEdit::ExtraSelection selection;
+      selection.format.setForeground(MATCH_TEXT_COLOR);
+      selection.format.setBackground(MATCH_BACK_COLOR);
+      selection.format.setProperty(QTextFormat::UserProperty, QString("findmatch"));
+
+      selection.cursor = QTextCursor(document());
+      selection.cursor.setPosition(start);
+      selection.cursor.setPosition(start + m_findIndex->get_MatchLength(index), QTextCursor::KeepAnchor);
+
+      matchList.append(selection);
+      ++index;
+   }
+
+   if (matchList.isEmpty() && m_matchSelections.isEmpty()) {
+      return;
+   }
+
+   m_matchSelections = matchList;
+
+   // the highlight bar and a column selection are kept
+   QList<QTextEdit::ExtraSelection> extraSelections;
+
+   for (const auto &item : this->extraSelections()) {
+      if (item.format.property(QTextFormat::UserProperty).toString() != "findmatch") {
+         extraSelections.append(item);
+      }
+   }
+
+   extraSelections.append(m_matchSelections);
+   setExtraSelections(extraSelections);
 }
 
 SyntaxTypes DiamondTextEdit::get_SyntaxEnum()
@@ -279,10 +452,13 @@ void DiamondTextEdit::set_SyntaxEnum(SyntaxTypes syntaxData)
 void DiamondTextEdit::set_Spell(bool value)
 {
    m_isSpellCheck = value;
-   m_syntaxParser->set_Spell(value);
 
-   // force syntax highlight to redraw
-   m_syntaxParser->rehighlight();
+   if (m_syntaxParser == nullptr) {
+      return;
+   }
+
+   // syntax highlight redraws with or without the underline
+   m_syntaxParser->set_Spell(value);
 }
 
 
@@ -347,7 +523,7 @@ void DiamondTextEdit::cut()
       // obtain text
       for (int k = 0; k < oldSelections.size(); ++k) {
 
-         if (oldSelections[k].format.property(QTextFormat::UserProperty).toString() != "highlightbar") {
+         if (isColumnSelection(oldSelections[k])) {
             text += oldSelections[k].cursor.selectedText() + "\n";
          }
       }
@@ -380,7 +556,7 @@ void DiamondTextEdit::cut()
 
          for (int k = 0; k < oldSelections.size(); ++k) {
 
-            if (oldSelections[k].format.property(QTextFormat::UserProperty).toString() != "highlightbar") {
+            if (isColumnSelection(oldSelections[k])) {
                oldSelections[k].cursor.removeSelectedText();
             }
          }
@@ -404,7 +580,7 @@ void DiamondTextEdit::copy()
       // obtain text
       for (int k = 0; k < oldSelections.count(); ++k) {
 
-         if (oldSelections[k].format.property(QTextFormat::UserProperty).toString() != "highlightbar") {
+         if (isColumnSelection(oldSelections[k])) {
             text += oldSelections[k].cursor.selectedText() + "\n";
          }
       }
@@ -520,8 +696,66 @@ QList<QKeyEvent *> DiamondTextEdit::get_MacroKeyList()
 
 
 // ** process key press
+void DiamondTextEdit::prefetch_Suggestions()
+{
+   if (m_spellCheck == nullptr || ! m_isSpellCheck || textCursor().hasSelection()) {
+      return;
+   }
+
+   QTextCursor cursor(textCursor());
+
+   // only underlined words, most identifiers are not in the dictionary and suggest is slow
+   if (m_syntaxParser == nullptr || ! m_syntaxParser->isMisspelled(cursor.block(), cursor.positionInBlock())) {
+      return;
+   }
+
+   cursor.select(QTextCursor::WordUnderCursor);
+
+   QString word = cursor.selectedText();
+   QStringList maybeList;
+
+   if (word.isEmpty() || m_spellCheck->get_Suggestions(word, maybeList)) {
+      return;
+   }
+
+   m_spellCheck->suggestAsync(word, this);
+}
+
+void DiamondTextEdit::add_Suggestions(const QString &word, const QStringList &maybeList)
+{
+   if (m_suggestMenu == nullptr || m_suggestWord != word) {
+      // prefetch only, the result is in the cache
+      return;
+   }
+
+   if (maybeList.isEmpty()) {
+      m_suggestAction->setText("No suggestions");
+      return;
+   }
+
+   for (const auto &item : maybeList)  {
+      QAction *action = m_suggestMenu->addAction(item, m_mainWindow, SLOT(spell_replaceWord())  );
+
+      m_suggestMenu->removeAction(action);
+      m_suggestMenu->insertAction(m_suggestAction, action);
+   }
+
+   m_suggestMenu->removeAction(m_suggestAction);
+   m_suggestAction = nullptr;
+
+   // menu may need to grow
+   m_suggestMenu->adjustSize();
+}
+
 bool DiamondTextEdit::event(QEvent *event)
 {
+   if (event->type() == SpellSuggestEvent::eventType()) {
+      SpellSuggestEvent *suggestEvent = static_cast<SpellSuggestEvent *>(event);
+      add_Suggestions(suggestEvent->m_word, suggestEvent->m_suggestions);
+
+      return true;
+   }
+
    if (event->type() == QEvent::ShortcutOverride) {
 
       QKeyEvent *keyPressEvent = dynamic_cast<QKeyEvent *>(event);
@@ -714,7 +948,12 @@ void DiamondTextEdit::keyPressEvent(QKeyEvent *event)
    }
 
    // process keys now
-   if (key == Qt::Key_Tab && (modifiers == Qt::NoModifier) ) {
+   if (key == Qt::Key_Escape && m_findIndex != nullptr && m_findIndex->isActive()) {
+      // clear the find highlights
+      m_findIndex->set_Pattern(QSharedPointer<const FindPattern>());
+      return;
+
+   } else if (key == Qt::Key_Tab && (modifiers == Qt::NoModifier) ) {
       m_mainWindow->indentIncr("tab");
       return;
 
@@ -17,16 +17,22 @@
 #ifndef DIAMOND_TEXTEDIT_H
 #define DIAMOND_TEXTEDIT_H
 
+#include "find_index.h"
 #include "spellcheck.h"
 #include "syntax.h"
 
+#include <QAction>
 #include <QList>
+#include <QMenu>
 #include <QObject>
 #include <QPaintEvent>
 #include <QPlainTextEdit>
 #include <QResizeEvent>
 #include <QSize>
+#include <QTextBlock>
 #include <QTextCursor>
+#include <QTextEdit>
+#include <QTimer>
 #include <QWidget>
 
 class LineNumberArea;
@@ -69,6 +75,14 @@ class DiamondTextEdit : public QPlainTextEdit
       SyntaxTypes get_SyntaxEnum();
       void set_SyntaxEnum(SyntaxTypes syntaxData);
 
+      // find highlights, matches of the current find text, nullptr before the first find when create is false
+      FindIndex *get_FindIndex(bool create = true);
+      QList<QTextEdit::ExtraSelection> get_MatchSelections();
+
+      // forwarded from the find index, which is replaced when the document changes
+      CS_SIGNAL_1(Public, void findMatchesChanged())
+      CS_SIGNAL_2(findMatchesChanged)
+
       CS_SLOT_1(Public, void cut())
       CS_SLOT_2(cut)
 
@@ -91,6 +105,12 @@ class DiamondTextEdit : public QPlainTextEdit
    private:
       void addToCopyBuffer(const QString &text);
       void removeColumnModeSpaces();
+      QTextBlock lastVisibleBlock();
+      void update_SyntaxViewport();
+      void update_MatchSelections(bool force);
+
+      void prefetch_Suggestions();
+      void add_Suggestions(const QString &word, const QStringList &maybeList);
 
       CS_SLOT_1(Private, void update_LineNumWidth(int newBlockCount))
       CS_SLOT_2(update_LineNumWidth)
@@ -125,10 +145,22 @@ class DiamondTextEdit : public QPlainTextEdit
       bool m_isSpellCheck;
       SpellCheck *m_spellCheck;
 
+      // suggestions computed on the spell check worker
+      QTimer m_suggestTimer;
+      QMenu *m_suggestMenu;
+      QAction *m_suggestAction;
+      QString m_suggestWord;
+
       // syntax
       Syntax *m_syntaxParser;
       QString m_synFName;
       SyntaxTypes m_syntaxEnum;
+
+      // find highlights, selections for the visible range [m_matchFirst, m_matchLast)
+      FindIndex *m_findIndex;
+      QList<QTextEdit::ExtraSelection> m_matchSelections;
+      int m_matchFirst;
+      int m_matchLast;
 };
 
 
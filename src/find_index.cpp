@@ -0,0 +1,367 @@
+/**************************************************************************
+*
+* Copyright (c) 2012-2025 Barbara Geller
+*
+* Diamond Editor is free software. You can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Diamond Editor is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* https://www.gnu.org/licenses/
+*
+***************************************************************************/
+
+
+#include "find_index.h"
+
+#include <QCoreApplication>
+#include <QRunnable>
+#include <QTextBlock>
+
+#include <algorithm>
+
+// number of blocks sent to the worker in one job
+static constexpr const int JOB_BLOCKS = 2000;
+
+static const QEvent::Type FIND_INDEX_EVENT = static_cast<QEvent::Type>(QEvent::registerEventType());
+
+// block text snapshot sent to the worker thread and the matches it found
+struct FindIndexJob
+{
+   int id;
+   int editCount;
+
+   // position of the first block
+   int start;
+
+   QVector<QString> texts;
+
+   QVector<int> starts;
+   QVector<int> lengths;
+};
+
+class FindIndexEvent : public QEvent
+{
+   public:
+      FindIndexEvent(QSharedPointer<FindIndexJob> job)
+         : QEvent(FIND_INDEX_EVENT), m_job(job)
+      { }
+
+      QSharedPointer<FindIndexJob> m_job;
+};
+
+class FindIndexTask : public QRunnable
+{
+   public:
+      FindIndexTask(FindIndex *index, QSharedPointer<const FindPattern> pattern,
+            QSharedPointer<FindIndexJob> job, std::atomic<int> *jobId)
+         : m_index(index), m_pattern(pattern), m_job(job), m_jobId(jobId)
+      { }
+
+      void run() override;
+
+   private:
+      FindIndex *m_index;
+      QSharedPointer<const FindPattern> m_pattern;
+      QSharedPointer<FindIndexJob> m_job;
+      std::atomic<int> *m_jobId;
+};
+
+void FindIndexTask::run()
+{
+   FindIndexJob &job = *m_job;
+
+   int position = job.start;
+
+   for (const QString &text : job.texts) {
+
+      if (m_jobId->load() != job.id) {
+         // cancelled by a new pattern
+         return;
+      }
+
+      for (const FindMatch &item : m_pattern->matchAll(text, 0)) {
+         job.starts.append(position + item.start);
+         job.lengths.append(item.length);
+      }
+
+      // blocks are separated by one position
+      position += text.size() + 1;
+   }
+
+   // FindIndex waits for this task in its destructor, the pointer is valid
+   QCoreApplication::postEvent(m_index, new FindIndexEvent(m_job));
+}
+
+// moves a range for an edit, a range which overlaps the edit grows to cover the new text
+static void adjustRange(int &start, int &end, int position, int charsRemoved, int charsAdded)
+{
+   int delta = charsAdded - charsRemoved;
+
+   if (end < position) {
+      return;
+   }
+
+   if (start > position + charsRemoved) {
+      start += delta;
+      end   += delta;
+      return;
+   }
+
+   start = qMin(start, position);
+
+   if (end >= position + charsRemoved) {
+      end += delta;
+   } else {
+      end = position + charsAdded;
+   }
+}
+
+FindIndex::FindIndex(QTextDocument *document)
+   : m_document(document), m_isDirty(false), m_dirtyStart(0), m_dirtyEnd(0), m_jobStart(0), m_jobEnd(0),
+     m_jobId(0), m_editCount(0), m_revision(document->revision())
+{
+   m_jobTimer.setSingleShot(true);
+
+   // one worker per document keeps the jobs in order
+   m_pool.setMaxThreadCount(1);
+
+   connect(&m_jobTimer, &QTimer::timeout, this, &FindIndex::startJob);
+   connect(document, &QTextDocument::contentsChange, this, &FindIndex::documentChanged);
+}
+
+FindIndex::~FindIndex()
+{
+   cancelJob();
+   m_pool.waitForDone();
+}
+
+void FindIndex::set_Pattern(QSharedPointer<const FindPattern> pattern)
+{
+   if (pattern == m_pattern) {
+      return;
+   }
+
+   cancelJob();
+
+   m_starts.clear();
+   m_lengths.clear();
+   m_isDirty = false;
+
+   if (! pattern.isNull() && ! pattern->isValid()) {
+      pattern.reset();
+   }
+
+   m_pattern = pattern;
+
+   if (! m_pattern.isNull() && ! m_document.isNull()) {
+      markDirty(0, m_document->characterCount());
+      startJob();
+   }
+
+   emit matchesChanged();
+}
+
+bool FindIndex::isComplete() const
+{
+   return isActive() && m_job.isNull() && ! m_isDirty;
+}
+
+int FindIndex::nextMatch(int position) const
+{
+   auto iter = std::lower_bound(m_starts.begin(), m_starts.end(), position);
+
+   if (iter == m_starts.end()) {
+      return -1;
+   }
+
+   return int(iter - m_starts.begin());
+}
+
+int FindIndex::previousMatch(int position) const
+{
+   auto iter = std::lower_bound(m_starts.begin(), m_starts.end(), position);
+
+   return int(iter - m_starts.begin()) - 1;
+}
+
+int FindIndex::indexOf(int start, int end) const
+{
+   int index = nextMatch(start);
+
+   if (index == -1 || m_starts[index] != start || m_starts[index] + m_lengths[index] != end) {
+      return -1;
+   }
+
+   return index;
+}
+
+void FindIndex::documentChanged(int position, int charsRemoved, int charsAdded)
+{
+   if (m_pattern.isNull()) {
+      return;
+   }
+
+   int delta = charsAdded - charsRemoved;
+
+   // the highlighter and the spell underline report format changes with the same removed and added count,
+   // only an edit of the text moves the revision
+   const int revision = m_document->revision();
+
+   if (delta == 0 && revision == m_revision) {
+      return;
+   }
+
+   m_revision = revision;
+
+   if (delta != 0) {
+      // matches which overlap the removed text are dropped, later matches move with the text
+      int first = int(std::lower_bound(m_starts.begin(), m_starts.end(), position) - m_starts.begin());
+      int last  = int(std::lower_bound(m_starts.begin(), m_starts.end(), position + charsRemoved) - m_starts.begin());
+
+      if (first > 0 && m_starts[first - 1] + m_lengths[first - 1] > position) {
+         --first;
+      }
+
+      m_starts.erase(m_starts.begin() + first, m_starts.begin() + last);
+      m_lengths.erase(m_lengths.begin() + first, m_lengths.begin() + last);
+
+      for (int k = first; k < m_starts.size(); ++k) {
+         m_starts[k] += delta;
+      }
+
+      // results of a running job no longer line up with the text
+      ++m_editCount;
+
+      if (! m_job.isNull()) {
+         adjustRange(m_jobStart, m_jobEnd, position, charsRemoved, charsAdded);
+      }
+
+      if (m_isDirty) {
+         adjustRange(m_dirtyStart, m_dirtyEnd, position, charsRemoved, charsAdded);
+      }
+   }
+
+   // blocks containing the edit are searched again
+   markDirty(position, position + charsAdded);
+   m_jobTimer.start(0);
+
+   if (delta != 0) {
+      emit matchesChanged();
+   }
+}
+
+void FindIndex::markDirty(int start, int end)
+{
+   if (m_isDirty) {
+      m_dirtyStart = qMin(m_dirtyStart, start);
+      m_dirtyEnd   = qMax(m_dirtyEnd, end);
+
+   } else {
+      m_isDirty    = true;
+      m_dirtyStart = start;
+      m_dirtyEnd   = end;
+
+   }
+}
+
+void FindIndex::startJob()
+{
+   if (! m_job.isNull() || ! m_isDirty || m_pattern.isNull() || m_document.isNull()) {
+      return;
+   }
+
+   QTextBlock block = m_document->findBlock(m_dirtyStart);
+
+   if (! block.isValid()) {
+      block = m_document->lastBlock();
+   }
+
+   QSharedPointer<FindIndexJob> job(new FindIndexJob);
+
+   job->id        = ++m_jobId;
+   job->editCount = m_editCount;
+   job->start     = block.position();
+
+   // snapshot of the block text, QString is implicitly shared so this is cheap
+   while (block.isValid() && (job->texts.isEmpty() || block.position() < m_dirtyEnd)
+         && job->texts.size() < JOB_BLOCKS) {
+
+      job->texts.append(block.text());
+      block = block.next();
+   }
+
+   m_jobStart = job->start;
+
+   if (block.isValid()) {
+      m_jobEnd = block.position();
+   } else {
+      m_jobEnd = m_document->characterCount();
+   }
+
+   // remaining blocks are sent in the next job
+   if (m_jobEnd >= m_dirtyEnd) {
+      m_isDirty = false;
+   } else {
+      m_dirtyStart = m_jobEnd;
+   }
+
+   m_job = job;
+   m_pool.start(new FindIndexTask(this, m_pattern, job, &m_jobId));
+}
+
+void FindIndex::cancelJob()
+{
+   // a running task checks the id after each block and stops
+   ++m_jobId;
+
+   m_job.reset();
+   m_jobTimer.stop();
+}
+
+bool FindIndex::event(QEvent *event)
+{
+   if (event->type() != FIND_INDEX_EVENT) {
+      return QObject::event(event);
+   }
+
+   QSharedPointer<FindIndexJob> job = static_cast<FindIndexEvent *>(event)->m_job;
+
+   if (job != m_job) {
+      // cancelled
+      return true;
+   }
+
+   m_job.reset();
+
+   if (job->editCount != m_editCount) {
+      // text moved while the job was running, search the same blocks again
+      markDirty(m_jobStart, m_jobEnd);
+
+   } else {
+      int first = int(std::lower_bound(m_starts.begin(), m_starts.end(), m_jobStart) - m_starts.begin());
+      int last  = int(std::lower_bound(m_starts.begin(), m_starts.end(), m_jobEnd) - m_starts.begin());
+
+      if (first == m_starts.size()) {
+         // searching the document from the start only adds to the end
+         m_starts  += job->starts;
+         m_lengths += job->lengths;
+
+      } else {
+         QVector<int> starts  = m_starts.mid(0, first) + job->starts + m_starts.mid(last);
+         QVector<int> lengths = m_lengths.mid(0, first) + job->lengths + m_lengths.mid(last);
+
+         m_starts  = starts;
+         m_lengths = lengths;
+      }
+
+      emit matchesChanged();
+   }
+
+   startJob();
+
+   return true;
+}
@@ -0,0 +1,126 @@
+/**************************************************************************
+*
+* Copyright (c) 2012-2025 Barbara Geller
+*
+* Diamond Editor is free software. You can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Diamond Editor is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* https://www.gnu.org/licenses/
+*
+***************************************************************************/
+
+
+#ifndef FIND_INDEX_H
+#define FIND_INDEX_H
+
+#include "find_pattern.h"
+
+#include <QEvent>
+#include <QObject>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QTextDocument>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+
+#include <atomic>
+
+struct FindIndexJob;
+
+// positions of every match of the find text in one document, kept current on a worker thread
+// only the blocks touched by an edit are searched again
+class FindIndex : public QObject
+{
+   CS_OBJECT(FindIndex)
+
+   public:
+      FindIndex(QTextDocument *document);
+      ~FindIndex();
+
+      // a null pattern clears the index
+      void set_Pattern(QSharedPointer<const FindPattern> pattern);
+
+      QTextDocument *get_Document() const {
+         return m_document;
+      }
+
+      // true when a pattern is set, matches are listed as they are found
+      bool isActive() const {
+         return ! m_pattern.isNull();
+      }
+
+      // true when every block has been searched since the last edit
+      bool isComplete() const;
+
+      int get_MatchCount() const {
+         return m_starts.size();
+      }
+
+      int get_MatchStart(int index) const {
+         return m_starts[index];
+      }
+
+      int get_MatchLength(int index) const {
+         return m_lengths[index];
+      }
+
+      // first match which starts at or after position, -1 when there is none
+      int nextMatch(int position) const;
+
+      // last match which starts before position, -1 when there is none
+      int previousMatch(int position) const;
+
+      // match which covers exactly the range [start, end), -1 when there is none
+      int indexOf(int start, int end) const;
+
+      CS_SIGNAL_1(Public, void matchesChanged())
+      CS_SIGNAL_2(matchesChanged)
+
+   protected:
+      bool event(QEvent *event) override;
+
+   private:
+      CS_SLOT_1(Private, void documentChanged(int position, int charsRemoved, int charsAdded))
+      CS_SLOT_2(documentChanged)
+
+      CS_SLOT_1(Private, void startJob())
+      CS_SLOT_2(startJob)
+
+      void cancelJob();
+      void markDirty(int start, int end);
+
+      QPointer<QTextDocument> m_document;
+      QSharedPointer<const FindPattern> m_pattern;
+
+      // sorted by position, matches do not overlap
+      QVector<int> m_starts;
+      QVector<int> m_lengths;
+
+      // text changed since it was searched, positions are updated for each edit
+      bool m_isDirty;
+      int m_dirtyStart;
+      int m_dirtyEnd;
+
+      // blocks sent to the worker, results are dropped if the text moved while the job was running
+      QSharedPointer<FindIndexJob> m_job;
+      int m_jobStart;
+      int m_jobEnd;
+
+      std::atomic<int> m_jobId;
+      int m_editCount;
+
+      // document revision of the last text change, format changes leave it unchanged
+      int m_revision;
+
+      // edits are collected while typing and searched together
+      QTimer m_jobTimer;
+      QThreadPool m_pool;
+};
+
+#endif
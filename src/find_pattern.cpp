@@ -0,0 +1,242 @@
+/**************************************************************************
+*
+* Copyright (c) 2012-2025 Barbara Geller
+*
+* Diamond Editor is free software. You can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Diamond Editor is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* https://www.gnu.org/licenses/
+*
+***************************************************************************/
+
+
+#include "find_pattern.h"
+
+#include <QHash>
+
+static constexpr const int PATTERN_CACHE_SIZE = 32;
+
+FindPattern::FindPattern(const QString &findText, bool matchCase, bool wholeWords, bool regexp)
+   : m_isRegexp(regexp)
+{
+   QString pattern;
+
+   if (regexp) {
+      pattern = findText;
+   } else {
+      pattern = escape(findText);
+   }
+
+   if (wholeWords) {
+      pattern = "\\b(?:" + pattern + ")\\b";
+   }
+
+   m_regExp = QRegularExpression(pattern);
+
+   if (! matchCase) {
+      m_regExp.setPatternOptions(QPatternOption::CaseInsensitiveOption);
+   }
+}
+
+QSharedPointer<const FindPattern> FindPattern::cached(const QString &findText, bool matchCase, bool wholeWords,
+      bool regexp)
+{
+   static QHash<QString, QSharedPointer<const FindPattern>> cache;
+
+   QString key = QString::number(int(matchCase) | int(wholeWords) << 1 | int(regexp) << 2) + ":" + findText;
+
+   QSharedPointer<const FindPattern> retval = cache.value(key);
+
+   if (retval.isNull()) {
+      if (cache.size() >= PATTERN_CACHE_SIZE) {
+         cache.clear();
+      }
+
+      retval = QSharedPointer<const FindPattern>(new FindPattern(findText, matchCase, wholeWords, regexp));
+      cache.insert(key, retval);
+   }
+
+   return retval;
+}
+
+bool FindPattern::isValid() const
+{
+   return m_regExp.isValid();
+}
+
+QString FindPattern::errorString() const
+{
+   return m_regExp.errorString();
+}
+
+FindMatch FindPattern::indexIn(const QString &text, int from) const
+{
+   FindMatch retval;
+   retval.start  = -1;
+   retval.length = 0;
+
+   if (! m_regExp.isValid() || from < 0 || from > text.size()) {
+      return retval;
+   }
+
+   auto pos = text.begin() + from;
+   QRegularExpressionMatch match = m_regExp.match(text, pos);
+
+   while (match.hasMatch()) {
+      auto start = match.capturedStart(0);
+      auto end   = match.capturedEnd(0);
+
+      if (start != end) {
+         retval.start  = from + int(start - pos);
+         retval.length = int(end - start);
+         break;
+      }
+
+      // empty match, move past it
+      if (end == text.end()) {
+         break;
+      }
+
+      match = m_regExp.match(text, ++end);
+   }
+
+   return retval;
+}
+
+FindMatch FindPattern::lastIndexIn(const QString &text, int to) const
+{
+   FindMatch retval;
+   retval.start  = -1;
+   retval.length = 0;
+
+   for (const FindMatch &item : findAll(text, 0, nullptr)) {
+      if (item.start >= to) {
+         break;
+      }
+
+      retval = item;
+   }
+
+   return retval;
+}
+
+QVector<FindMatch> FindPattern::matchAll(const QString &text, int from) const
+{
+   return findAll(text, from, nullptr);
+}
+
+QVector<FindMatch> FindPattern::replaceAll(const QString &text, int from, const QString &replaceText) const
+{
+   return findAll(text, from, &replaceText);
+}
+
+QVector<FindMatch> FindPattern::findAll(const QString &text, int from, const QString *replaceText) const
+{
+   QVector<FindMatch> retval;
+
+   if (! m_regExp.isValid() || from < 0 || from > text.size()) {
+      return retval;
+   }
+
+   // captured text is only looked up when the replacement refers to it
+   bool isExpand = m_isRegexp && replaceText != nullptr && replaceText->contains('\\');
+
+   // offsets are counted from the previous match so the text is walked once
+   auto pos      = text.begin() + from;
+   int posOffset = from;
+
+   QRegularExpressionMatch match = m_regExp.match(text, pos);
+
+   while (match.hasMatch()) {
+      auto start = match.capturedStart(0);
+      auto end   = match.capturedEnd(0);
+
+      if (start == end) {
+         // empty match, move past it
+         if (end == text.end()) {
+            break;
+         }
+
+         ++end;
+
+      } else {
+         FindMatch item;
+         item.start  = posOffset + int(start - pos);
+         item.length = int(end - start);
+
+         if (isExpand) {
+            item.newText = expand(match, *replaceText);
+
+         } else if (replaceText != nullptr) {
+            item.newText = *replaceText;
+
+         }
+
+         retval.append(item);
+      }
+
+      posOffset += int(end - pos);
+      pos = end;
+
+      match = m_regExp.match(text, pos);
+   }
+
+   return retval;
+}
+
+QString FindPattern::expand(const QRegularExpressionMatch &match, const QString &replaceText)
+{
+   QString retval;
+   bool isEscape = false;
+
+   for (QChar c : replaceText) {
+
+      if (! isEscape) {
+         if (c == '\\') {
+            isEscape = true;
+         } else {
+            retval.append(c);
+         }
+
+         continue;
+      }
+
+      isEscape = false;
+
+      if (c.isDigit()) {
+         // group which did not take part in the match inserts nothing
+         retval.append(match.captured(c.digitValue()));
+
+      } else {
+         // any other character is inserted as is, \\ for a backslash
+         retval.append(c);
+
+      }
+   }
+
+   if (isEscape) {
+      retval.append('\\');
+   }
+
+   return retval;
+}
+
+QString FindPattern::escape(const QString &text)
+{
+   QString retval;
+
+   for (QChar c : text) {
+      if (! c.isLetterOrNumber()) {
+         retval.append('\\');
+      }
+
+      retval.append(c);
+   }
+
+   return retval;
+}
@@ -0,0 +1,72 @@
+/**************************************************************************
+*
+* Copyright (c) 2012-2025 Barbara Geller
+*
+* Diamond Editor is free software. You can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Diamond Editor is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* https://www.gnu.org/licenses/
+*
+***************************************************************************/
+
+
+#ifndef FIND_PATTERN_H
+#define FIND_PATTERN_H
+
+#include <QRegularExpression>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+struct FindMatch
+{
+   int start;
+   int length;
+
+   // replacement with the captured text inserted, only set by replaceAll()
+   QString newText;
+};
+
+// find text and options compiled once, used to search a snapshot of the document text
+class FindPattern
+{
+   public:
+      FindPattern(const QString &findText, bool matchCase, bool wholeWords, bool regexp);
+
+      // compiled patterns are kept for the next search with the same text and options, only used on the GUI thread
+      static QSharedPointer<const FindPattern> cached(const QString &findText, bool matchCase, bool wholeWords,
+            bool regexp);
+
+      bool isValid() const;
+      QString errorString() const;
+
+      // first match at or after position from, start is -1 when there is no match
+      FindMatch indexIn(const QString &text, int from) const;
+
+      // last match which starts before position to, start is -1 when there is no match
+      FindMatch lastIndexIn(const QString &text, int to) const;
+
+      // every match at or after position from, in order, matches do not overlap and empty matches are skipped
+      QVector<FindMatch> matchAll(const QString &text, int from) const;
+
+      // same as matchAll() and sets the new text of each match, \1 to \9 insert captured text
+      // when the find text is a regular expression
+      QVector<FindMatch> replaceAll(const QString &text, int from, const QString &replaceText) const;
+
+      // escapes every character which is not a letter or a digit
+      static QString escape(const QString &text);
+
+   private:
+      QVector<FindMatch> findAll(const QString &text, int from, const QString *replaceText) const;
+      static QString expand(const QRegularExpressionMatch &match, const QString &replaceText);
+
+      QRegularExpression m_regExp;
+      bool m_isRegexp;
+};
+
+#endif
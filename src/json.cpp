@@ -102,6 +102,7 @@ bool MainWindow::json_Read(Config trail)
       m_struct.isColumnMode      = object.value("column-mode").toBool();
       m_struct.isSpellCheck      = object.value("spellcheck").toBool();
       m_struct.isWordWrap        = object.value("word-wrap").toBool();
+      m_struct.spellComments     = object.value("spell-comments").toBool(true);
       m_struct.removeSpace       = object.value("removeSpace").toBool();
       m_struct.showLineHighlight = object.value("showLineHighlight").toBool();
       m_struct.showLineNumbers   = object.value("showLineNumbers").toBool();
@@ -239,6 +240,17 @@ bool MainWindow::json_Read(Config trail)
       m_advFindFileType   = object.value("advFile-filetype").toString();
       m_advFindFolder     = object.value("advFile-folder").toString();
       m_advFSearchFolders = object.value("advFile-searchFolders").toBool();
+      m_advFUseIndex      = object.value("advFile-useIndex").toBool();
+
+      if (object.contains("advFile-maxSize")) {
+         m_advFMaxSize = object.value("advFile-maxSize").toInt();
+      }
+
+      if (object.contains("advFile-skipFolders")) {
+         m_advFindSkipFolders = object.value("advFile-skipFolders").toString();
+      } else {
+         m_advFindSkipFolders = ".git, .svn, build, node_modules";
+      }
 
       // find list
       list = object.value("find-list").toArray();
@@ -373,6 +385,9 @@ bool MainWindow::json_Write(Option route, Config trail)
             object.insert("advFile-filetype",      m_advFindFileType);
             object.insert("advFile-folder",        m_advFindFolder);
             object.insert("advFile-searchFolders", m_advFSearchFolders);
+            object.insert("advFile-skipFolders",   m_advFindSkipFolders);
+            object.insert("advFile-useIndex",      m_advFUseIndex);
+            object.insert("advFile-maxSize",       m_advFMaxSize);
             break;
 
          case AUTOLOAD:
@@ -684,6 +699,10 @@ bool MainWindow::json_Write(Option route, Config trail)
             object.insert("spellcheck", m_struct.isSpellCheck);
             break;
 
+         case SPELL_COMMENTS:
+            object.insert("spell-comments", m_struct.spellComments);
+            break;
+
          case TAB_SPACING:
             object.insert("tabSpacing", m_struct.tabSpacing);
             break;
@@ -842,6 +861,7 @@ bool MainWindow::json_CreateNew()
    object.insert("showSpaces",  false);
    object.insert("showBreaks",  false);
    object.insert("spellcheck",  false);
+   object.insert("spell-comments", true);
    object.insert("word-wrap",   false);
 
    value = QJsonValue(QString("MM/dd/yyyy"));
@@ -973,6 +993,11 @@ bool MainWindow::json_CreateNew()
    value = QJsonValue(m_appPath);
    object.insert("advFile-folder",     value);
 
+   value = QJsonValue(QString(".git, .svn, build, node_modules"));
+   object.insert("advFile-skipFolders", value);
+
+   object.insert("advFile-maxSize",     50);
+
    // print options
    value = QJsonValue(QString());
 
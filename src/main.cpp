@@ -16,10 +16,12 @@
 
 #include "diamond_build_info.h"
 #include "mainwindow.h"
+#include "syntax_profiler.h"
 #include "util.h"
 
 #include <QApplication>
 #include <QDialog>
+#include <QDir>
 #include <QLabel>
 #include <QVBoxLayout>
 
@@ -59,6 +61,22 @@ int main(int argc, char *argv[])
       okToRun = false;
    }
 
+   // syntax rule statistics are written when the program exits
+   QString profileFile;
+
+   for (const QString &flag : flagList) {
+      if (flag.compare("--profile_syntax", Qt::CaseInsensitive) == 0) {
+         profileFile = QDir::currentPath() + "/syntax_profile.json";
+
+      } else if (flag.startsWith("--profile_syntax=", Qt::CaseInsensitive)) {
+         profileFile = flag.mid(17);
+      }
+   }
+
+   if (! profileFile.isEmpty()) {
+      SyntaxProfiler::setEnabled(true);
+   }
+
    if (okToRun) {
 
       try{
@@ -67,6 +85,10 @@ int main(int argc, char *argv[])
 
          retval = app.exec();
 
+         if (! profileFile.isEmpty()) {
+            SyntaxProfiler::writeJson(profileFile);
+         }
+
       } catch (std::exception &e) {
          const QString what = QString::fromUtf8(e.what());
 
@@ -101,6 +123,7 @@ static void showHelp()
 
       "<tr><td width=200>&minus;&minus;no_autoload</td><td width=240>Force no auto load of previously open files</td></tr>"
       "<tr><td>&minus;&minus;no_saveconfig</td><td>Do not save config file</td></tr>"
+      "<tr><td>&minus;&minus;profile_syntax[=fileName]</td><td>Save syntax rule statistics as JSON on exit</td></tr>"
       "<tr></tr>"
 
       "<tr><td>[fileName] [fileName] ...</td><td>Files to open when starting Diamond</td></tr></table><br>";
@@ -15,6 +15,7 @@
 ***************************************************************************/
 
 #include "diamond_build_info.h"
+#include "dialog_syntax_profile.h"
 #include "mainwindow.h"
 
 #include <QFileInfo>
@@ -166,6 +167,9 @@ void MainWindow::tabNew()
    connect(m_textEdit, &DiamondTextEdit::cursorPositionChanged,     this, &MainWindow::moveBar);
    connect(m_textEdit, &DiamondTextEdit::cursorPositionChanged,     this, &MainWindow::setStatus_LineCol);
 
+   // counter is shown once the index of the find text is complete
+   connect(m_textEdit, &DiamondTextEdit::findMatchesChanged, this, &MainWindow::setStatus_FindCount);
+
    connect(m_textEdit, &DiamondTextEdit::undoAvailable, m_ui->actionUndo, &QAction::setEnabled);
    connect(m_textEdit, &DiamondTextEdit::redoAvailable, m_ui->actionRedo, &QAction::setEnabled);
    connect(m_textEdit, &DiamondTextEdit::copyAvailable, m_ui->actionCut,  &QAction::setEnabled);
@@ -328,6 +332,14 @@ void MainWindow::diamondHelp()
    }
 }
 
+void MainWindow::syntaxProfile()
+{
+   Dialog_SyntaxProfile *dw = new Dialog_SyntaxProfile(this, m_spellCheck);
+   dw->exec();
+
+   delete dw;
+}
+
 void MainWindow::about()
 {
    // change mainwindow.cpp & main.cpp
@@ -498,6 +510,7 @@ void MainWindow::createConnections()
 
    // help menu
    connect(m_ui->actionDiamond_Help,      &QAction::triggered, this, &MainWindow::diamondHelp);
+   connect(m_ui->actionSyntax_Profile,    &QAction::triggered, this, &MainWindow::syntaxProfile);
    connect(m_ui->actionAbout,             &QAction::triggered, this, &MainWindow::about);
 }
 
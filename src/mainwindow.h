@@ -17,6 +17,7 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include "advfind_search.h"
 #include "diamond_edit.h"
 #include "settings.h"
 #include "spellcheck.h"
@@ -36,6 +37,7 @@
 #include <QPrinter>
 #include <QPushButton>
 #include <QRectF>
+#include <QScopedPointer>
 #include <QShortcut>
 #include <QSplitter>
 #include <QStackedWidget>
@@ -44,7 +46,9 @@
 #include <QString>
 #include <QStringList>
 
+class AdvFindModel;
 class Dialog_AdvFind;
+class FindPattern;
 
 static constexpr const int MACRO_MAX          = 10;
 static constexpr const int OPENTABS_MAX       = 20;
@@ -60,13 +64,6 @@ struct macroStruct
    QString text;
 };
 
-struct advFindStruct
-{
-   QString fileName;
-   int lineNumber;
-   QString text;
-};
-
 class MainWindow : public QMainWindow
 {
    CS_OBJECT(MainWindow)
@@ -78,7 +75,7 @@ class MainWindow : public QMainWindow
          MACRO_LOAD, MACRO_SAVE, MACRO_TAG_NAMES,
          PATH_SYNTAX, PATH_PRIOR, PRESET_FOLDER, PRINT_OPTIONS, RECENTFOLDER, RECENTFILE, REMOVE_SPACE,
          REWRAP_COLUMN, SHOW_LINEHIGHLIGHT, SHOW_LINENUMBERS, SHOW_SPACES, SHOW_BREAKS, SPELLCHECK,
-         STYLESHEET, TAB_SPACING, USESPACES, WORDWRAP
+         SPELL_COMMENTS, STYLESHEET, TAB_SPACING, USESPACES, WORDWRAP
       };
 
       MainWindow(QStringList fileList, QStringList flagList);
@@ -102,9 +99,6 @@ class MainWindow : public QMainWindow
       void saveTabs(QString jsonTag);
       void loadTabs(QString jsonTag);
 
-      // spell
-      QStringList spell_getMaybe(QString word);
-
       // support
       QString get_DirPath(QString message, QString path);
       bool loadFile(QString fileName, bool newTab, bool isAuto, bool isReload = false);
@@ -132,9 +126,13 @@ class MainWindow : public QMainWindow
 
       int getReply();
 
-      QList<advFindStruct> advFind_getResults(bool &aborted);
-      void findRecursive(const QString &path, bool isFirstLoop = true);
-      void advFind_ShowFiles(QList<advFindStruct> foundList);
+      void advFind_getResults(AdvFindSearch &search, bool &aborted);
+      void advFind_ShowFiles(AdvFindModel *model);
+      void advFind_ReplaceFiles(const QVector<QSharedPointer<AdvReplaceFile>> &fileList);
+
+      // selects the next match of the find text, the compiled pattern is reused for repeated searches
+      QSharedPointer<const FindPattern> find_Pattern();
+      bool find_Match(bool isBackward);
 
       void replaceQuery();
       void replaceAll();
@@ -345,11 +343,13 @@ class MainWindow : public QMainWindow
 
       // help
       void diamondHelp();
+      void syntaxProfile();
       void about();
 
       //
       void documentWasModified();
       void setStatus_LineCol();
+      void setStatus_FindCount();
       void mw_tabClose();
       void tabChanged(int index);
 
@@ -426,25 +426,35 @@ class MainWindow : public QMainWindow
 
       QString m_findText;
       QStringList m_findList;
-      QTextDocument::FindFlags m_flags;
       bool m_fDirection;
       bool m_fMatchCase;
       bool m_fWholeWords;
+      bool m_fRegexp = false;
 
       Dialog_AdvFind *m_dwAdvFind;
       QString m_advFindText;
+      QString m_advReplaceText;
       QString m_advFindFileType;
       QString m_advFindFolder;
 
+      // comma separated folder names which are not searched
+      QString m_advFindSkipFolders;
+
+      // in MB, larger files are not searched, 0 for no limit
+      int m_advFMaxSize = 50;
+
       bool m_advFMatchCase  = false;
       bool m_advFWholeWords = false;
       bool m_advFRegexp     = false;
 
       bool m_advFSearchFolders;
 
-      QStringList m_recursiveList;
+      // trigram index of each searched folder, created the first time it is used
+      bool m_advFUseIndex = false;
+      QScopedPointer<TrigramIndex> m_advFindIndex;
+
       QFrame *m_findWidget;
-      QStandardItemModel *m_model;
+      AdvFindModel *m_advFindModel;
 
       // replace
       QString m_replaceText;
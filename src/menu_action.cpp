@@ -1046,6 +1046,10 @@ void MainWindow::moveBar()
    selection.cursor.clearSelection();
 
    extraSelections.append(selection);
+
+   // matches of the find text stay highlighted
+   extraSelections.append(m_textEdit->get_MatchSelections());
+
    m_textEdit->setExtraSelections(extraSelections);
 }
 
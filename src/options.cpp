@@ -84,11 +84,7 @@ void MainWindow::setColors()
       colors.setColor(QPalette::Base, m_struct.colorBack);
       m_textEdit->setPalette(colors);
 
-      // get saved value
-      QString synFName = m_textEdit->get_SyntaxFile();
-
       // change colors for  every tab
-      DiamondTextEdit *cur_textEdit  = m_textEdit;
       int count = m_tabWidget->count();
 
       QWidget *temp;
@@ -99,19 +95,15 @@ void MainWindow::setColors()
          textEdit = dynamic_cast<DiamondTextEdit *>(temp);
 
          if (textEdit) {
-            m_textEdit = textEdit;
-
-            // get saved value
-            synFName = m_textEdit->get_SyntaxFile();
+            Syntax *parser = textEdit->get_SyntaxParser();
 
-            // reloads the syntax blocks based on new colors
-            runSyntax(synFName);
+            // swaps the palette and repaints, the syntax rules are not run again
+            if (parser != nullptr) {
+               parser->processSyntax(m_struct);
+            }
          }
       }
 
-      // reassign current tab
-      m_textEdit = cur_textEdit;
-
       // for this tab only, it is updated every tab change
       moveBar();
 
@@ -149,6 +141,7 @@ void MainWindow::setOptions()
    options.useSpaces    = m_struct.useSpaces;
    options.removeSpace  = m_struct.removeSpace;
    options.autoLoad     = m_struct.autoLoad;
+   options.spellComments = m_struct.spellComments;
    options.dictMain     = m_struct.dictMain;
    options.dictUser     = m_struct.dictUser;
    options.pathSyntax   = m_struct.pathSyntax;
@@ -236,6 +229,30 @@ void MainWindow::setOptions()
          json_Write(AUTOLOAD);
       }
 
+      if (m_struct.spellComments != options.spellComments) {
+         m_struct.spellComments = options.spellComments;
+         json_Write(SPELL_COMMENTS);
+
+         // run for every tab
+         int count = m_tabWidget->count();
+
+         QWidget *temp;
+         DiamondTextEdit *textEdit;
+
+         for (int k = 0; k < count; ++k)  {
+            temp     = m_tabWidget->widget(k);
+            textEdit = dynamic_cast<DiamondTextEdit *>(temp);
+
+            if (textEdit) {
+               Syntax *parser = textEdit->get_SyntaxParser();
+
+               if (parser != nullptr) {
+                  parser->set_SpellComments(m_struct.spellComments);
+               }
+            }
+         }
+      }
+
       //
       if (m_struct.dictMain != options.dictMain ) {
          m_struct.dictMain = options.dictMain;
@@ -14,19 +14,46 @@
 *
 ***************************************************************************/
 
+#include "advfind_model.h"
+#include "advfind_search.h"
 #include "dialog_advfind.h"
 #include "dialog_find.h"
 #include "dialog_replace.h"
+#include "find_pattern.h"
 #include "mainwindow.h"
 #include "search.h"
 
 #include <QBoxLayout>
 #include <QDir>
+#include <QHeaderView>
+#include <QMap>
 #include <QMessageBox>
+#include <QPlainTextEdit>
 #include <QProgressDialog>
+#include <QSet>
 #include <QTableView>
+#include <QTextBlock>
+#include <QTextDocument>
 #include <QTextStream>
 
+static constexpr const int ADVREPLACE_PREVIEW_MAX = 5000;
+
+// replacement for the selected match, captured text is inserted when the find text is a regular expression
+static QString replaceSelection(const FindPattern &pattern, const QTextCursor &cursor, const QString &replaceText)
+{
+   QTextBlock block = cursor.block();
+
+   // matched again in the whole block so anchors and word boundaries see the surrounding text
+   QVector<FindMatch> matchList = pattern.replaceAll(block.text(), cursor.selectionStart() - block.position(),
+         replaceText);
+
+   if (matchList.isEmpty()) {
+      return replaceText;
+   }
+
+   return matchList.first().newText;
+}
+
 // * find
 void MainWindow::find()
 {
@@ -58,26 +85,19 @@ void MainWindow::find()
 
       json_Write(FIND_LIST, CFG_OVERRIDE);
 
-      // get the flags
-      m_flags = nullptr;
-
+      // get the options
       m_fDirection  = dw->get_Direction();
-      if (! m_fDirection) {
-         m_flags |= QTextDocument::FindBackward;
-      }
+      m_fMatchCase  = dw->get_MatchCase();
+      m_fWholeWords = dw->get_WholeWords();
+      m_fRegexp     = dw->get_Regexp();
 
-      m_fMatchCase = dw->get_MatchCase();
-      if (m_fMatchCase) {
-         m_flags |= QTextDocument::FindCaseSensitively;
-      }
+      QSharedPointer<const FindPattern> pattern = find_Pattern();
 
-      m_fWholeWords = dw->get_WholeWords();
-      if (m_fWholeWords){
-         m_flags |= QTextDocument::FindWholeWords;
-      }
+      if (! pattern->isValid()) {
+         csError("Find", "Invalid regular expression: " + pattern->errorString());
 
-      if (! m_findText.isEmpty())  {
-         bool found = m_textEdit->find(m_findText, m_flags);
+      } else if (! m_findText.isEmpty())  {
+         bool found = find_Match(! m_fDirection);
 
          if (! found)  {
             // text not found, query if the user wants to search from top of file
@@ -103,8 +123,14 @@ void MainWindow::findNext()
 {
    // emerald - may want to modify m_FindText when text contains html
 
-   QTextDocument::FindFlags flags = QTextDocument::FindFlags(~QTextDocument::FindBackward & m_flags);
-   bool found = m_textEdit->find(m_findText, flags);
+   QSharedPointer<const FindPattern> pattern = find_Pattern();
+
+   if (! pattern->isValid()) {
+      csError("Find", "Invalid regular expression: " + pattern->errorString());
+      return;
+   }
+
+   bool found = find_Match(false);
 
    if (! found)  {
       QString msg = "Not found: " + m_findText + "\n\n";
@@ -132,13 +158,125 @@ void MainWindow::findNext()
 
 void MainWindow::findPrevious()
 {
-   bool found = m_textEdit->find(m_findText, QTextDocument::FindBackward | m_flags );
+   QSharedPointer<const FindPattern> pattern = find_Pattern();
+
+   if (! pattern->isValid()) {
+      csError("Find", "Invalid regular expression: " + pattern->errorString());
+      return;
+   }
+
+   bool found = find_Match(true);
 
    if (! found)  {
       csError("Find", "Not found: " + m_findText);
    }
 }
 
+QSharedPointer<const FindPattern> MainWindow::find_Pattern()
+{
+   return FindPattern::cached(m_findText, m_fMatchCase, m_fWholeWords, m_fRegexp);
+}
+
+bool MainWindow::find_Match(bool isBackward)
+{
+   QSharedPointer<const FindPattern> pattern = find_Pattern();
+
+   if (m_findText.isEmpty() || ! pattern->isValid()) {
+      return false;
+   }
+
+   QTextCursor cursor(m_textEdit->textCursor());
+
+   // every match is highlighted, the index is built on a worker thread
+   FindIndex *findIndex = m_textEdit->get_FindIndex();
+   findIndex->set_Pattern(pattern);
+
+   if (findIndex->isComplete()) {
+      int index;
+
+      if (isBackward) {
+         index = findIndex->previousMatch(cursor.selectionStart());
+      } else {
+         index = findIndex->nextMatch(cursor.selectionEnd());
+      }
+
+      if (index == -1) {
+         return false;
+      }
+
+      int start = findIndex->get_MatchStart(index);
+
+      cursor.setPosition(start);
+      cursor.setPosition(start + findIndex->get_MatchLength(index), QTextCursor::KeepAnchor);
+      m_textEdit->setTextCursor(cursor);
+
+      setStatus_FindCount();
+
+      return true;
+   }
+
+   // index is not ready, search the document, matches do not span blocks the same as QTextDocument::find()
+   FindMatch match;
+   QTextBlock block;
+
+   if (isBackward) {
+      int position = cursor.selectionStart();
+
+      block  = m_textEdit->document()->findBlock(position);
+      match  = pattern->lastIndexIn(block.text(), position - block.position());
+
+      while (match.start == -1) {
+         block = block.previous();
+
+         if (! block.isValid()) {
+            return false;
+         }
+
+         match = pattern->lastIndexIn(block.text(), block.length());
+      }
+
+   } else {
+      int position = cursor.selectionEnd();
+
+      block  = m_textEdit->document()->findBlock(position);
+      match  = pattern->indexIn(block.text(), position - block.position());
+
+      while (match.start == -1) {
+         block = block.next();
+
+         if (! block.isValid()) {
+            return false;
+         }
+
+         match = pattern->indexIn(block.text(), 0);
+      }
+   }
+
+   cursor.setPosition(block.position() + match.start);
+   cursor.setPosition(block.position() + match.start + match.length, QTextCursor::KeepAnchor);
+   m_textEdit->setTextCursor(cursor);
+
+   return true;
+}
+
+void MainWindow::setStatus_FindCount()
+{
+   // no index until the first find in this editor
+   FindIndex *findIndex = m_textEdit->get_FindIndex(false);
+
+   if (findIndex == nullptr || ! findIndex->isComplete()) {
+      return;
+   }
+
+   QTextCursor cursor(m_textEdit->textCursor());
+   int index = findIndex->indexOf(cursor.selectionStart(), cursor.selectionEnd());
+
+   if (index != -1) {
+      setStatusBar(tr("Match %1 of %2").formatArgs(QString::number(index + 1),
+            QString::number(findIndex->get_MatchCount())), 0);
+   }
+}
+
 
 // * advanced find
 void MainWindow::advFind()
@@ -152,23 +290,28 @@ void MainWindow::advFind()
       m_advFindText = selectedText;
    }
 
-   m_dwAdvFind = new Dialog_AdvFind(this, m_advFindText, m_advFindFileType, m_advFindFolder, m_advFSearchFolders,
-         m_advFMatchCase, m_advFWholeWords, m_advFRegexp);
+   m_dwAdvFind = new Dialog_AdvFind(this, m_advFindText, m_advReplaceText, m_advFindFileType, m_advFindFolder,
+         m_advFindSkipFolders, m_advFMaxSize, m_advFSearchFolders, m_advFUseIndex, m_advFMatchCase, m_advFWholeWords,
+         m_advFRegexp);
 
    while (true) {
       int result = m_dwAdvFind->exec();
 
       if (result == QDialog::Accepted) {
 
-         m_advFindText       = m_dwAdvFind->get_findText();
-         m_advFindFileType   = m_dwAdvFind->get_findType();
-         m_advFindFolder     = m_dwAdvFind->get_findFolder();
+         m_advFindText        = m_dwAdvFind->get_findText();
+         m_advReplaceText     = m_dwAdvFind->get_replaceText();
+         m_advFindFileType    = m_dwAdvFind->get_findType();
+         m_advFindFolder      = m_dwAdvFind->get_findFolder();
+         m_advFindSkipFolders = m_dwAdvFind->get_skipFolders();
+         m_advFMaxSize        = m_dwAdvFind->get_MaxSize();
 
          // get the flags
-         m_advFMatchCase     = m_dwAdvFind->get_MatchCase();
-         m_advFWholeWords    = m_dwAdvFind->get_WholeWords();
-         m_advFRegexp        = m_dwAdvFind->get_Regexp();
-         m_advFSearchFolders = m_dwAdvFind->get_SearchSubFolders();
+         m_advFMatchCase      = m_dwAdvFind->get_MatchCase();
+         m_advFWholeWords     = m_dwAdvFind->get_WholeWords();
+         m_advFRegexp         = m_dwAdvFind->get_Regexp();
+         m_advFSearchFolders  = m_dwAdvFind->get_SearchSubFolders();
+         m_advFUseIndex       = m_dwAdvFind->get_UseIndex();
 
          json_Write(ADVFIND);
 
@@ -184,21 +327,58 @@ void MainWindow::advFind()
 
             //
             bool aborted = false;
-            QList<advFindStruct> foundList = advFind_getResults(aborted);
+            bool found   = true;
+
+            AdvFindOptions options;
+            options.findText   = m_advFindText;
+            options.matchCase  = m_advFMatchCase;
+            options.wholeWords = m_advFWholeWords;
+            options.regexp     = m_advFRegexp;
+
+            AdvFindSearch search(options);
+            search.set_MaxFileSize(qint64(m_advFMaxSize) * 1024 * 1024);
+
+            if (m_dwAdvFind->get_IsReplace()) {
+               search.set_Replace(m_advReplaceText);
+               advFind_getResults(search, aborted);
+
+               if (aborted)  {
+                  // do nothing
+
+               } else if (search.get_ReplaceFiles().isEmpty())  {
+                  found = false;
+
+               } else   {
+                  advFind_ReplaceFiles(search.get_ReplaceFiles());
+
+               }
+
+            } else {
+               AdvFindModel *model = new AdvFindModel;
+
+               search.set_Model(model);
+               advFind_getResults(search, aborted);
+
+               if (aborted)  {
+                  // do nothing
+                  delete model;
+
+               } else if (model->rowCount() == 0)  {
+                  delete model;
+                  found = false;
 
-            if (aborted)  {
-               // do nothing
+               } else   {
+                  advFind_ShowFiles(model);
 
-            } else if (foundList.isEmpty())  {
+               }
+            }
+
+            if (! found) {
                csError("Advanced Find", "Not found: " + m_advFindText);
 
                // allow user to search again
                m_dwAdvFind->showNotBusyMsg();
                continue;
-
-            } else   {
-               advFind_ShowFiles(foundList);
-
             }
          }
 
@@ -214,30 +394,16 @@ void MainWindow::advFind()
    delete m_dwAdvFind;
 }
 
-QList<advFindStruct> MainWindow::advFind_getResults(bool &aborted)
+void MainWindow::advFind_getResults(AdvFindSearch &search, bool &aborted)
 {
    aborted = false;
 
    // part 1
-   QStringList searchList;
-   QDir currentDir;
-
-   if (m_advFSearchFolders)  {
-      m_recursiveList.clear();
-
-      findRecursive(m_advFindFolder);
-      searchList = m_recursiveList;
-
-   } else {
-      currentDir = QDir(m_advFindFolder);
-      searchList = currentDir.entryList(QStringList(m_advFindFileType), QDir::Files | QDir::NoSymLinks);
-   }
-
    QProgressDialog progressDialog(this);
 
    progressDialog.setMinimumDuration(1500);
    progressDialog.setMinimumWidth(275);
-   progressDialog.setRange(0, searchList.size());
+   progressDialog.setRange(0, 0);
    progressDialog.setWindowTitle(tr("Advanced File Search"));
 
    progressDialog.setCancelButtonText(tr("&Cancel"));
@@ -253,126 +419,213 @@ QList<advFindStruct> MainWindow::advFind_getResults(bool &aborted)
    progressDialog.setLabel(label);
 
    // part 2
-   QList<advFindStruct> foundList;
-   QString name;
+   QStringList skipFolders;
+
+   for (const QString &item : m_advFindSkipFolders.split(",")) {
+      QString folder = item.trimmed();
 
-   enum Qt::CaseSensitivity caseFlag;
+      if (! folder.isEmpty()) {
+         skipFolders.append(folder);
+      }
+   }
 
-   QRegularExpression regExp;
+   if (m_advFSearchFolders)  {
+      m_dwAdvFind->showBusyMsg();
+   }
 
-   if (m_advFWholeWords) {
-      regExp = QRegularExpression("\\b" + m_advFindText + "\\b");
+   // files are searched on the thread pool while the folders are still being listed
+   bool useIndex = m_advFUseIndex && m_advFSearchFolders;
 
-   } else if (m_advFRegexp) {
-      regExp = QRegularExpression(m_advFindText);
+   if (useIndex) {
+      if (m_advFindIndex.isNull()) {
+         m_advFindIndex.reset(new TrigramIndex(pathName(m_jsonFname) + "/index"));
+      }
 
+      search.set_Index(m_advFindIndex.data());
    }
 
-   if (m_advFMatchCase) {
-      caseFlag = Qt::CaseSensitive;
+   search.start(m_advFindFolder, m_advFindFileType, skipFolders, m_advFSearchFolders);
 
-   }  else {
-      caseFlag = Qt::CaseInsensitive;
-      regExp.setPatternOptions(QPatternOption::CaseInsensitiveOption);
+   while (! search.isFinished()) {
 
-   }
+      if (search.isWalking()) {
+         // total is not known yet, show a busy indicator
+         progressDialog.setMaximum(0);
 
-   // process each file
-   for (int k = 0; k < searchList.size(); ++k) {
+      } else {
+         progressDialog.setMaximum(search.get_FileCount());
+         progressDialog.setValue(search.get_FilesDone());
+      }
+
+      progressDialog.setLabelText(tr("Searching file %1 of %2\nMatches found: %3")
+            .formatArg(search.get_FilesDone()).formatArg(search.get_FileCount()).formatArg(search.get_MatchCount()));
 
-      progressDialog.setValue(k);
-      progressDialog.setLabelText(tr("Searching file %1 of %2").formatArg(k).formatArg(searchList.size()));
-      qApp->processEvents();
+      qApp->processEvents(QEventLoop::WaitForMoreEvents);
 
       if (progressDialog.wasCanceled()) {
+         search.cancel();
+
          aborted = true;
          break;
       }
+   }
 
-      if (m_advFSearchFolders)  {
-         name = searchList[k];
+   if (useIndex && ! aborted) {
+      // files changed since the last search are indexed in the background
+      m_advFindIndex->update(TrigramIndex::rootPath(m_advFindFolder), skipFolders);
+   }
+}
+
+void MainWindow::advFind_ReplaceFiles(const QVector<QSharedPointer<AdvReplaceFile>> &fileList)
+{
+   // files open in a tab, modified files are never written
+   QMap<QString, int> openTabs;
+   QSet<QString> modifiedFiles;
 
-      } else  {
-         name = currentDir.absoluteFilePath(searchList[k]);
+   for (int index = 0; index < m_tabWidget->count(); ++index) {
+      QString fileName = get_curFileName(index);
+      DiamondTextEdit *textEdit = dynamic_cast<DiamondTextEdit *>(m_tabWidget->widget(index));
 
+      if (fileName.isEmpty() || textEdit == nullptr) {
+         continue;
       }
 
-#if defined (Q_OS_WIN)
-      // change forward to backslash
-      name.replace('/', '\\');
-#endif
+      if (textEdit->document()->isModified()) {
+         modifiedFiles.insert(fileName);
+      } else {
+         openTabs.insert(fileName, index);
+      }
+   }
 
-      QFile file(name);
+   QVector<QSharedPointer<AdvReplaceFile>> writeList;
+   QStringList skipList;
 
-      if (file.open(QIODevice::ReadOnly)) {
-         QString line;
-         QTextStream in(&file);
+   int replaceCount = 0;
 
-         int lineNumber = 0;
-         int position   = 0;
+   // preview of the changed lines
+   QString preview;
+   int previewLines = 0;
+   bool previewFull = false;
 
-         while (! in.atEnd()) {
+   for (const auto &item : fileList) {
 
-            line = in.readLine();
-            ++lineNumber;
+      if (modifiedFiles.contains(item->fileName)) {
+         skipList.append(item->fileName + tr("  (open with unsaved changes)"));
+         continue;
+      }
 
-            if (m_advFWholeWords || m_advFRegexp)  {
-               position = line.indexOf(regExp);
+      if (! item->valid) {
+         skipList.append(item->fileName + tr("  (not valid UTF-8)"));
+         continue;
+      }
 
-            } else  {
-               position = line.indexOf(m_advFindText, 0, caseFlag);
+      writeList.append(item);
+      replaceCount += item->count;
 
-            }
+      if (previewFull) {
+         continue;
+      }
 
-            // store the results
-            if (position != -1)  {
-               advFindStruct temp;
+      if (previewLines == ADVREPLACE_PREVIEW_MAX) {
+         previewFull = ! item->lines.isEmpty();
+         continue;
+      }
 
-               temp.fileName   = name;
-               temp.lineNumber = lineNumber;
-               temp.text       = line.trimmed();
+      preview += "=== " + item->fileName + "\n";
 
-               foundList.append(temp);
-            }
+      for (const auto &line : item->lines) {
+
+         if (previewLines == ADVREPLACE_PREVIEW_MAX) {
+            previewFull = true;
+            break;
          }
+
+         preview += QString("%1: - %2\n").formatArgs(QString::number(line.lineNumber), line.oldText);
+         preview += QString("%1: + %2\n").formatArgs(QString::number(line.lineNumber), line.newText);
+
+         ++previewLines;
       }
 
-      file.close();
+      preview += "\n";
    }
 
-   return foundList;
-}
+   if (previewFull) {
+      preview += tr("Preview limit reached, remaining changes are not shown\n");
+   }
 
-void MainWindow::findRecursive(const QString &path, bool isFirstLoop)
-{
-   QDir dir(path);
-   dir.setFilter(QDir::AllDirs | QDir::Files | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+   if (! skipList.isEmpty()) {
+      preview += tr("=== Files which will not be changed\n") + skipList.join("\n") + "\n";
+   }
 
-   QFileInfoList list = dir.entryInfoList(QStringList(m_advFindFileType));
-   int cnt = list.count();
+   // confirm
+   QDialog dw(this);
+   dw.setWindowTitle(tr("Replace in Files"));
+   dw.setWindowIcon(QIcon("://resources/diamond.png"));
+   dw.resize(800, 500);
 
-   if (isFirstLoop && cnt > 0) {
-      m_dwAdvFind->showBusyMsg();
-   }
+   QLabel *label = new QLabel;
+   label->setText(tr("Replace %1 occurrences of \"%2\" in %3 files")
+         .formatArgs(QString::number(replaceCount), m_advFindText, QString::number(writeList.size())));
 
-   if (! list.isEmpty()) {
-      for (int k = 0; k != cnt; ++k) {
+   QPlainTextEdit *previewText = new QPlainTextEdit;
+   previewText->setReadOnly(true);
+   previewText->setLineWrapMode(QPlainTextEdit::NoWrap);
+   previewText->setFont(m_struct.fontNormal);
+   previewText->setPlainText(preview);
 
-          QString filePath = list[k].filePath();
+   QPushButton *replaceButton = new QPushButton(tr("Replace"));
+   QPushButton *cancelButton  = new QPushButton(tr("Cancel"));
 
-         if ( list[k].isDir() )  {
-            // recursive
-            findRecursive(filePath, false);
+   replaceButton->setEnabled(! writeList.isEmpty());
 
-         } else  {
-            m_recursiveList.append(filePath);
+   QBoxLayout *buttonLayout = new QHBoxLayout();
+   buttonLayout->addStretch();
+   buttonLayout->addWidget(replaceButton);
+   buttonLayout->addSpacing(8);
+   buttonLayout->addWidget(cancelButton);
+   buttonLayout->addStretch();
 
-         }
+   QBoxLayout *layout = new QVBoxLayout();
+   layout->addWidget(label);
+   layout->addWidget(previewText);
+   layout->addLayout(buttonLayout);
+
+   dw.setLayout(layout);
+
+   connect(replaceButton, &QPushButton::clicked, &dw, &QDialog::accept);
+   connect(cancelButton,  &QPushButton::clicked, &dw, &QDialog::reject);
+
+   if (dw.exec() != QDialog::Accepted) {
+      return;
+   }
+
+   QApplication::setOverrideCursor(Qt::WaitCursor);
+   QStringList errors = AdvFindSearch::writeReplaceFiles(writeList);
+   QApplication::restoreOverrideCursor();
+
+   // tabs showing a file which was written are reloaded
+   int currentTab = m_tabWidget->currentIndex();
+
+   for (const auto &item : writeList) {
+      auto iter = openTabs.find(item->fileName);
+
+      if (iter != openTabs.end()) {
+         m_tabWidget->setCurrentIndex(iter.value());
+         loadFile(item->fileName, false, false, true);
       }
    }
+
+   m_tabWidget->setCurrentIndex(currentTab);
+
+   if (! errors.isEmpty()) {
+      csError(tr("Replace in Files"), tr("Unable to save the following files:\n\n") + errors.join("\n"));
+   }
+
+   setStatusBar(tr("Replaced %1 occurrences in %2 files")
+         .formatArgs(QString::number(replaceCount), QString::number(writeList.size() - errors.size())), 0);
 }
 
-void MainWindow::advFind_ShowFiles(QList<advFindStruct> foundList)
+void MainWindow::advFind_ShowFiles(AdvFindModel *model)
 {
    int index = m_splitter->indexOf(m_findWidget);
 
@@ -386,13 +639,11 @@ void MainWindow::advFind_ShowFiles(QList<advFindStruct> foundList)
 
    QTableView *view = new QTableView(this);
 
-   m_model = new QStandardItemModel;
-   m_model->setColumnCount(3);
-   m_model->setHeaderData(0, Qt::Horizontal, tr("File Name"));
-   m_model->setHeaderData(1, Qt::Horizontal, tr("Line #"));
-   m_model->setHeaderData(2, Qt::Horizontal, tr("Text"));
+   // model is deleted with the find window
+   m_advFindModel = model;
+   m_advFindModel->setParent(m_findWidget);
 
-   view->setModel(m_model);
+   view->setModel(m_advFindModel);
 
    view->setSelectionMode(QAbstractItemView::SingleSelection);
    view->setSelectionBehavior(QAbstractItemView::SelectRows);
@@ -403,6 +654,10 @@ void MainWindow::advFind_ShowFiles(QList<advFindStruct> foundList)
 
    view->horizontalHeader()->setStretchLastSection(true);
 
+   // all rows have the same height, the view does not measure each row
+   view->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+   view->verticalHeader()->setDefaultSectionSize(view->fontMetrics().height() + 6);
+
    // use main window font and size, add feature to allow user to change font
    // following code out for now since the font was too large
 
@@ -414,26 +669,6 @@ void MainWindow::advFind_ShowFiles(QList<advFindStruct> foundList)
    view->setAlternatingRowColors(true);
    view->setStyleSheet("alternate-background-color: lightyellow");
 
-   int row = 0;
-
-   for (const auto &entry : foundList) {
-
-      QStandardItem *item0  = new QStandardItem(entry.fileName);
-      QStandardItem *item1  = new QStandardItem(QString::number(entry.lineNumber));
-      QStandardItem *item2  = new QStandardItem(entry.text);
-
-      if (entry.fileName.endsWith(".wpd")) {
-         item2->setText("** WordPerfect file, text format incompatible");
-      }
-
-      m_model->insertRow(row);
-      m_model->setItem(row, 0, item0);
-      m_model->setItem(row, 1, item1);
-      m_model->setItem(row, 2, item2);
-
-      ++row;
-   }
-
    //
    QPushButton *closeButton = new QPushButton();
    closeButton->setText("Close");
@@ -452,9 +687,6 @@ void MainWindow::advFind_ShowFiles(QList<advFindStruct> foundList)
    m_splitter->setOrientation(Qt::Vertical);
    m_splitter->addWidget(m_findWidget);
 
-   // must call after addWidget
-   view->resizeRowsToContents();
-
    connect(view,        &QTableView::clicked,  this, &MainWindow::advFind_View);
    connect(closeButton, &QPushButton::clicked, this, &MainWindow::advFind_Close);
 }
@@ -472,13 +704,8 @@ void MainWindow::advFind_View(const QModelIndex &modelIndex)
       return;
    }
 
-   QString fileName = m_model->item(row,0)->data(Qt::DisplayRole).toString();
-   int lineNumber   = m_model->item(row,1)->data(Qt::DisplayRole).toInt();
-
-   if (fileName.endsWith(".wpd")) {
-      csError("Open File", "WordPerfect file, text format incompatible with Diamond");
-      return;
-   }
+   QString fileName = m_advFindModel->get_FileName(row);
+   int lineNumber   = m_advFindModel->get_LineNumber(row);
 
    // is the file already open?
    bool open = false;
@@ -553,20 +780,17 @@ void MainWindow::replace()
 
       }
 
-      // get the flags
-      m_flags = nullptr;
+      // get the options
+      m_fMatchCase  = dw->get_MatchCase();
+      m_fWholeWords = dw->get_WholeWords();
+      m_fRegexp     = dw->get_Regexp();
 
-      m_fMatchCase = dw->get_MatchCase();
-      if (m_fMatchCase) {
-         m_flags |= QTextDocument::FindCaseSensitively;
-      }
+      QSharedPointer<const FindPattern> pattern = find_Pattern();
 
-      m_fWholeWords = dw->get_WholeWords();
-      if (m_fWholeWords){
-         m_flags |= QTextDocument::FindWholeWords;
-      }
+      if (! pattern->isValid()) {
+         csError("Replace", "Invalid regular expression: " + pattern->errorString());
 
-      if (! m_findText.isEmpty() && ! m_replaceText.isEmpty())  {
+      } else if (! m_findText.isEmpty() && ! m_replaceText.isEmpty())  {
 
          if (result == 1)   {
             replaceQuery();
@@ -610,8 +834,10 @@ void MainWindow::replaceQuery()
 
    ReplaceReply *dw = nullptr;
 
+   QSharedPointer<const FindPattern> pattern = find_Pattern();
+
    while (true) {
-      found = m_textEdit->find(m_findText, m_flags);
+      found = find_Match(false);
 
       if (found) {
 
@@ -646,7 +872,7 @@ void MainWindow::replaceQuery()
 
          } else if (key == Qt::Key_O)  {
             cursor  = m_textEdit->textCursor();
-            cursor.insertText(m_replaceText);
+            cursor.insertText(replaceSelection(*pattern, cursor, m_replaceText));
 
             break;
 
@@ -655,7 +881,7 @@ void MainWindow::replaceQuery()
 
          } else if (key == Qt::Key_Y)  {
             cursor  = m_textEdit->textCursor();
-            cursor.insertText(m_replaceText);
+            cursor.insertText(replaceSelection(*pattern, cursor, m_replaceText));
 
          }
 
@@ -680,37 +906,58 @@ void MainWindow::replaceQuery()
 
 void MainWindow::replaceAll()
 {
-   bool isFirst = true;
-   bool found;
+   QSharedPointer<const FindPattern> pattern = find_Pattern();
 
-   // begin undo block
+   // a selected match is replaced as well
    QTextCursor cursor(m_textEdit->textCursor());
-   cursor.beginEditBlock();
+   int from = cursor.selectionStart();
 
-   while (true) {
-      found = m_textEdit->find(m_findText, m_flags);
+   // each line is matched on its own like find and the match count, a match never spans a line break
+   QVector<FindMatch> matchList;
 
-      if (found) {
-         isFirst = false;
+   for (QTextBlock block = m_textEdit->document()->findBlock(from); block.isValid(); block = block.next()) {
+      const int position = block.position();
+
+      for (FindMatch item : pattern->replaceAll(block.text(), qMax(from - position, 0), m_replaceText)) {
+         item.start += position;
+         matchList.append(item);
+      }
+   }
 
-         cursor  = m_textEdit->textCursor();
-         cursor.insertText(m_replaceText);
+   if (matchList.isEmpty()) {
+      csError("Replace All", "Not found: " + m_findText);
+      return;
+   }
 
-      } else {
-         break;
+   // begin undo block, the document reports the block as one change so the highlighter
+   // and the editor are only updated once
+   cursor.beginEditBlock();
+
+   // replace from the end so the offsets of the earlier matches are unchanged
+   int lastIndex = matchList.size() - 1;
+   int delta     = 0;
+
+   for (int k = lastIndex; k >= 0; --k) {
+      const FindMatch &item = matchList[k];
 
+      cursor.setPosition(item.start);
+      cursor.setPosition(item.start + item.length, QTextCursor::KeepAnchor);
+      cursor.insertText(item.newText);
+
+      if (k != lastIndex) {
+         delta += item.newText.size() - item.length;
       }
    }
 
-   cursor.clearSelection();
-   m_textEdit->setTextCursor(cursor);
-
    // end of undo
    cursor.endEditBlock();
 
-   if (isFirst) {
-      csError("Replace All", "Not found: " + m_findText);
-   }
+   // leave the cursor after the last replacement
+   const FindMatch &last = matchList[lastIndex];
+   cursor.setPosition(last.start + delta + last.newText.size());
+   m_textEdit->setTextCursor(cursor);
+
+   setStatusBar(tr("Replaced %1 occurrences").formatArg(QString::number(matchList.size())), 2000);
 }
 
 
@@ -29,6 +29,7 @@ struct Settings {
    bool  isColumnMode;
    bool  isSpellCheck;
    bool  isWordWrap;
+   bool  spellComments;
    bool  removeSpace;
    bool  showLineHighlight;
    bool  showLineNumbers;
@@ -120,6 +121,7 @@ struct Options {
 
    bool  autoLoad;
    bool  removeSpace;
+   bool  spellComments;
    bool  useSpaces;
 
    QString aboutUrl;
@@ -46,15 +46,6 @@ void MainWindow::spell_replaceWord()
    }
 }
 
-QStringList MainWindow::spell_getMaybe(QString word)
-{
-   if ( m_spellCheck->spell(word) )   {
-      return QStringList();
-   } else {
-      return m_spellCheck->suggest(word);
-   }
-}
-
 void MainWindow::setSyntax()
 {
    if (m_syntaxParser) {
@@ -0,0 +1,395 @@
+/**************************************************************************
+*
+* Copyright (c) 2012-2025 Barbara Geller
+*
+* Diamond Editor is free software. You can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Diamond Editor is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* https://www.gnu.org/licenses/
+*
+***************************************************************************/
+
+
+#include "spell_snapshot.h"
+
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QSet>
+#include <QStringList>
+#include <QTextCodec>
+#include <QVector>
+
+#include <algorithm>
+#include <cstring>
+
+static constexpr const quint32 SNAPSHOT_MAGIC   = 0x44535053;
+static constexpr const quint32 SNAPSHOT_VERSION = 1;
+
+// file layout, header followed by the word offsets, the hash slots and the UTF-8 text of the words
+struct SnapshotHeader
+{
+   quint32 magic;
+   quint32 version;
+
+   // dictionary the snapshot was built from
+   qint64 dicSize;
+   qint64 dicModified;
+   qint64 affSize;
+   qint64 affModified;
+
+   quint32 wordCount;
+   quint32 slotCount;
+   quint32 blobSize;
+   quint32 reserved;
+};
+
+static quint32 hashWord(const char *data, int length)
+{
+   // FNV-1a
+   quint32 hash = 2166136261u;
+
+   for (int k = 0; k < length; ++k) {
+      hash ^= quint8(data[k]);
+      hash *= 16777619u;
+   }
+
+   return hash;
+}
+
+// splits the flag field of a dictionary entry according to the FLAG option of the affix file
+static QStringList parseFlags(const QString &flags, const QString &flagType)
+{
+   QStringList retval;
+
+   if (flagType == "long") {
+      for (int k = 0; k + 1 < flags.size(); k += 2) {
+         retval.append(flags.mid(k, 2));
+      }
+
+   } else if (flagType == "num") {
+      retval = flags.split(",");
+
+   } else {
+      for (QChar c : flags) {
+         retval.append(QString(c));
+      }
+   }
+
+   return retval;
+}
+
+SpellSnapshot::SpellSnapshot()
+   : m_wordCount(0), m_slotCount(0), m_blobSize(0), m_offsets(nullptr), m_slots(nullptr), m_blob(nullptr)
+{
+}
+
+SpellSnapshot::~SpellSnapshot()
+{
+   close();
+}
+
+void SpellSnapshot::close()
+{
+   // unmapped when the file is closed
+   m_file.close();
+
+   m_wordCount = 0;
+   m_slotCount = 0;
+   m_blobSize  = 0;
+
+   m_offsets = nullptr;
+   m_slots   = nullptr;
+   m_blob    = nullptr;
+}
+
+bool SpellSnapshot::open(const QString &fileName, const QString &dicFName, const QString &affFName)
+{
+   close();
+
+   m_file.setFileName(fileName);
+
+   if (! m_file.open(QIODevice::ReadOnly)) {
+      return false;
+   }
+
+   const qint64 fileSize = m_file.size();
+
+   if (fileSize < qint64(sizeof(SnapshotHeader))) {
+      close();
+      return false;
+   }
+
+   const uchar *data = m_file.map(0, fileSize);
+
+   if (data == nullptr) {
+      close();
+      return false;
+   }
+
+   const SnapshotHeader *header = reinterpret_cast<const SnapshotHeader *>(data);
+
+   QFileInfo dicInfo(dicFName);
+   QFileInfo affInfo(affFName);
+
+   if (header->magic != SNAPSHOT_MAGIC || header->version != SNAPSHOT_VERSION ||
+         header->dicSize != dicInfo.size() || header->dicModified != dicInfo.lastModified().toMSecsSinceEpoch() ||
+         header->affSize != affInfo.size() || header->affModified != affInfo.lastModified().toMSecsSinceEpoch()) {
+      // stale, written on a machine with a different byte order, or not a snapshot
+      close();
+      return false;
+   }
+
+   const quint32 slotCount = header->slotCount;
+
+   qint64 expected = qint64(sizeof(SnapshotHeader)) + 4 * (qint64(header->wordCount) + 1) +
+         4 * qint64(slotCount) + header->blobSize;
+
+   if (expected != fileSize || slotCount == 0 || (slotCount & (slotCount - 1)) != 0) {
+      close();
+      return false;
+   }
+
+   m_wordCount = header->wordCount;
+   m_slotCount = slotCount;
+   m_blobSize  = header->blobSize;
+
+   m_offsets = reinterpret_cast<const quint32 *>(data + sizeof(SnapshotHeader));
+   m_slots   = m_offsets + m_wordCount + 1;
+   m_blob    = reinterpret_cast<const char *>(m_slots + m_slotCount);
+
+   return true;
+}
+
+bool SpellSnapshot::contains(const QByteArray &word) const
+{
+   if (m_slots == nullptr || word.isEmpty()) {
+      return false;
+   }
+
+   const quint32 mask   = m_slotCount - 1;
+   const quint32 length = word.size();
+
+   quint32 slot = hashWord(word.constData(), length) & mask;
+
+   // the table is at most half full, an empty slot ends the probe
+   for (quint32 probe = 0; probe < m_slotCount; ++probe) {
+      quint32 entry = m_slots[slot];
+
+      if (entry == 0 || entry > m_wordCount) {
+         return false;
+      }
+
+      quint32 start = m_offsets[entry - 1];
+      quint32 end   = m_offsets[entry];
+
+      if (start <= end && end <= m_blobSize && end - start == length &&
+            std::memcmp(m_blob + start, word.constData(), length) == 0) {
+         return true;
+      }
+
+      slot = (slot + 1) & mask;
+   }
+
+   return false;
+}
+
+bool SpellSnapshot::build(const QString &fileName, const QString &dicFName, const QString &affFName)
+{
+   QFile affFile(affFName);
+
+   if (! affFile.open(QIODevice::ReadOnly)) {
+      return false;
+   }
+
+   const QByteArray affData = affFile.readAll();
+   affFile.close();
+
+   // hunspell default when there is no SET option
+   QByteArray encoding = "ISO8859-1";
+
+   for (const QByteArray &line : affData.split('\n')) {
+      if (line.startsWith("SET ")) {
+         encoding = line.mid(4).trimmed();
+         break;
+      }
+   }
+
+   QTextCodec *codec = QTextCodec::codecForName(encoding);
+
+   if (codec == nullptr) {
+      return false;
+   }
+
+   QString flagType;
+   QSet<QString> excludeFlags;
+
+   for (const QByteArray &data : affData.split('\n')) {
+      QStringList fields = codec->toUnicode(data).simplified().split(' ');
+
+      if (fields.size() < 2) {
+         continue;
+      }
+
+      const QString &option = fields[0];
+
+      if (option == "FLAG") {
+         flagType = fields[1];
+
+      } else if (option == "FORBIDDENWORD" || option == "NEEDAFFIX" || option == "PSEUDOROOT" ||
+            option == "ONLYINCOMPOUND") {
+         excludeFlags.insert(fields[1]);
+      }
+   }
+
+   QFile dicFile(dicFName);
+
+   if (! dicFile.open(QIODevice::ReadOnly)) {
+      return false;
+   }
+
+   const QByteArray dicData = dicFile.readAll();
+   dicFile.close();
+
+   // value is false when any entry for the word has an excluded flag
+   QHash<QByteArray, bool> wordList;
+
+   QList<QByteArray> lines = dicData.split('\n');
+
+   // first line is the approximate word count
+   for (int k = 1; k < lines.size(); ++k) {
+      QString line = codec->toUnicode(lines[k]);
+
+      // morphological fields follow the word after white space
+      int end = 0;
+
+      while (end < line.size() && line[end] != '\t' && line[end] != ' ' && line[end] != '\r') {
+         ++end;
+      }
+
+      line.truncate(end);
+
+      // a slash in the word itself is escaped
+      int slash = 0;
+
+      while (true) {
+         slash = line.indexOf('/', slash);
+
+         if (slash <= 0 || line[slash - 1] != '\\') {
+            break;
+         }
+
+         ++slash;
+      }
+
+      QString word  = line;
+      QString flags;
+
+      if (slash > 0) {
+         word  = line.left(slash);
+         flags = line.mid(slash + 1);
+      }
+
+      word.replace("\\/", "/");
+
+      if (word.isEmpty()) {
+         continue;
+      }
+
+      bool isValid = true;
+
+      for (const QString &flag : parseFlags(flags, flagType)) {
+         if (excludeFlags.contains(flag)) {
+            isValid = false;
+            break;
+         }
+      }
+
+      QByteArray key = word.toUtf8();
+
+      auto iter = wordList.find(key);
+
+      if (iter == wordList.end()) {
+         wordList.insert(key, isValid);
+
+      } else if (! isValid) {
+         iter.value() = false;
+      }
+   }
+
+   QVector<QByteArray> words;
+   words.reserve(wordList.size());
+
+   for (auto iter = wordList.cbegin(); iter != wordList.cend(); ++iter) {
+      if (iter.value()) {
+         words.append(iter.key());
+      }
+   }
+
+   // same input produces the same file
+   std::sort(words.begin(), words.end());
+
+   quint32 slotCount = 2;
+
+   while (slotCount < 2 * quint32(words.size())) {
+      slotCount *= 2;
+   }
+
+   QVector<quint32> offsets;
+   QVector<quint32> slots(slotCount, 0);
+   QByteArray blob;
+
+   offsets.reserve(words.size() + 1);
+
+   for (int k = 0; k < words.size(); ++k) {
+      const QByteArray &word = words[k];
+
+      offsets.append(blob.size());
+      blob.append(word);
+
+      quint32 slot = hashWord(word.constData(), word.size()) & (slotCount - 1);
+
+      while (slots[slot] != 0) {
+         slot = (slot + 1) & (slotCount - 1);
+      }
+
+      slots[slot] = k + 1;
+   }
+
+   offsets.append(blob.size());
+
+   QFileInfo dicInfo(dicFName);
+   QFileInfo affInfo(affFName);
+
+   SnapshotHeader header;
+   std::memset(&header, 0, sizeof(header));
+
+   header.magic       = SNAPSHOT_MAGIC;
+   header.version     = SNAPSHOT_VERSION;
+   header.dicSize     = dicInfo.size();
+   header.dicModified = dicInfo.lastModified().toMSecsSinceEpoch();
+   header.affSize     = affInfo.size();
+   header.affModified = affInfo.lastModified().toMSecsSinceEpoch();
+   header.wordCount   = words.size();
+   header.slotCount   = slotCount;
+   header.blobSize    = blob.size();
+
+   // replaced in one step, another process may have the old snapshot mapped
+   QSaveFile file(fileName);
+
+   if (! file.open(QIODevice::WriteOnly)) {
+      return false;
+   }
+
+   file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+   file.write(reinterpret_cast<const char *>(offsets.constData()), offsets.size() * sizeof(quint32));
+   file.write(reinterpret_cast<const char *>(slots.constData()), slots.size() * sizeof(quint32));
+   file.write(blob);
+
+   return file.commit();
+}
@@ -0,0 +1,58 @@
+/**************************************************************************
+*
+* Copyright (c) 2012-2025 Barbara Geller
+*
+* Diamond Editor is free software. You can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Diamond Editor is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* https://www.gnu.org/licenses/
+*
+***************************************************************************/
+
+
+#ifndef SPELL_SNAPSHOT_H
+#define SPELL_SNAPSHOT_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+// read only table of the stem words in a Hunspell dictionary, mapped directly from disk
+class SpellSnapshot
+{
+   public:
+      SpellSnapshot();
+      ~SpellSnapshot();
+
+      // false when the file is missing or was built from a different dictionary
+      bool open(const QString &fileName, const QString &dicFName, const QString &affFName);
+      void close();
+
+      bool isOpen() const {
+         return m_slots != nullptr;
+      }
+
+      // word is UTF-8, only exact matches are found, affix forms are left to Hunspell
+      bool contains(const QByteArray &word) const;
+
+      // stems which are forbidden, need an affix or are only valid in compounds are left out
+      static bool build(const QString &fileName, const QString &dicFName, const QString &affFName);
+
+   private:
+      QFile m_file;
+
+      quint32 m_wordCount;
+      quint32 m_slotCount;
+      quint32 m_blobSize;
+
+      const quint32 *m_offsets;
+      const quint32 *m_slots;
+      const char *m_blob;
+};
+
+#endif
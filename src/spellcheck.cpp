@@ -15,16 +15,93 @@
 ***************************************************************************/
 
 #include "spellcheck.h"
+#include "syntax.h"
+#include "syntax_profiler.h"
 #include "util.h"
 
 #include <QByteArray>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QStandardPaths>
+#include <QTextBoundaryFinder>
 #include <QTextCodec>
 #include <QTextStream>
 
 #include <hunspell.hxx>
 
+#include <functional>
+
+static constexpr const int CACHE_LIMIT   = 50000;
+static constexpr const int SUGGEST_LIMIT = 500;
+
+class SpellTask : public QRunnable
+{
+   public:
+      SpellTask(std::function<void ()> func)
+         : m_func(std::move(func))
+      { }
+
+      void run() override {
+         m_func();
+      }
+
+   private:
+      std::function<void ()> m_func;
+};
+
+// leading punctuation is not part of the word
+static QString stripWord(QStringView word)
+{
+   QString retval(word);
+
+   while (! retval.isEmpty() && ! retval.at(0).isLetter()) {
+      retval = retval.mid(1);
+   }
+
+   return retval;
+}
+
+// the dictionary folder is often read only, snapshots are kept in the per user cache folder
+// named by the path and the time stamp of the dictionary so an updated dictionary is converted again
+static QString snapshotFileName(const QString &dicFName)
+{
+   QFileInfo info(dicFName);
+
+   QString path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+
+   if (path.isEmpty() || ! QDir().mkpath(path)) {
+      return info.absolutePath() + "/" + info.completeBaseName() + ".snapshot";
+   }
+
+   QByteArray key = QCryptographicHash::hash(info.absoluteFilePath().toUtf8(), QCryptographicHash::Md5).toHex();
+
+   return path + "/" + info.completeBaseName() + "-" + QString::fromLatin1(key) + "-"
+         + QString::number(info.lastModified().toMSecsSinceEpoch()) + ".snapshot";
+}
+
+QEvent::Type SpellResultEvent::eventType()
+{
+   static const QEvent::Type type = static_cast<QEvent::Type>(QEvent::registerEventType());
+
+   return type;
+}
+
+QEvent::Type SpellSuggestEvent::eventType()
+{
+   static const QEvent::Type type = static_cast<QEvent::Type>(QEvent::registerEventType());
+
+   return type;
+}
+
 SpellCheck::SpellCheck(const QString &dictMain, const QString &dictUser)
+   : m_cacheHits(0), m_cacheMisses(0), m_suggestReceiver(nullptr), m_dictRevision(0),
+     m_workerRevision(-1), m_workerHunspell(nullptr)
 {
    m_userFname = dictUser;
 
@@ -42,7 +119,9 @@ SpellCheck::SpellCheck(const QString &dictMain, const QString &dictUser)
       csError("Spell Check", "Dictionary Support File was not found\n" + affFName);
    }
 
-   m_hunspell = new Hunspell(affFName .constData(), dicFName.constData() );
+   m_affFName = affFName;
+   m_dicFName = dicFName;
+   m_snapshotFName = snapshotFileName(dicFName);
 
    // encode as SET option in the affix file
    m_codec = QTextCodec::codecForName("UTF-8");
@@ -50,70 +129,310 @@ SpellCheck::SpellCheck(const QString &dictMain, const QString &dictUser)
    if (m_userFname.isEmpty()) {
       csError("Spell Check", "Unable to find User Dictionary");
 
-   } else {
-      QFile file(m_userFname);
+   } else if (! QFileInfo(m_userFname).isReadable()) {
+      QString error = QObject::tr("Unable to read User Dictionary\n%1").formatArgs(m_userFname);
+      csError("Spell Check", error);
+   }
 
-      if (! file.open(QFile::ReadOnly)) {
-         QString error = QObject::tr("Unable to read User Dictionary\n%1\n\n%2").formatArgs(m_userFname, file.errorString());
-         csError("Spell Check", error);
-         return;
+   // dictionaries are loaded on the worker thread when the first batch is checked
+   m_pool.setMaxThreadCount(1);
+}
+
+SpellCheck::~SpellCheck()
+{
+   m_pool.waitForDone();
+
+   delete m_workerHunspell;
+}
+
+void SpellCheck::spellBatch(QSharedPointer<SpellBatch> batch)
+{
+   batch->dictRevision = m_dictRevision.load();
+   m_pool.start(new SpellTask([this, batch] () { runBatch(batch); } ));
+}
+
+void SpellCheck::cancelBatch(QSharedPointer<SpellBatch> batch)
+{
+   // a running batch checks the receiver after each block and stops
+   QMutexLocker lock(&batch->mutex);
+   batch->receiver = nullptr;
+}
+
+int SpellCheck::get_DictRevision() const
+{
+   return m_dictRevision.load();
+}
+
+void SpellCheck::prepareWorker()
+{
+   // runs on the worker thread before each task
+   if (m_workerHunspell == nullptr) {
+      // converted once, later sessions only map the file
+      bool isOpen;
+
+      {
+         QMutexLocker lock(&m_mutex);
+         isOpen = m_snapshot.open(m_snapshotFName, m_dicFName, m_affFName);
       }
 
-      QTextStream stream(&file);
+      if (! isOpen && SpellSnapshot::build(m_snapshotFName, m_dicFName, m_affFName)) {
+         QMutexLocker lock(&m_mutex);
+         m_snapshot.open(m_snapshotFName, m_dicFName, m_affFName);
+      }
+
+      m_workerHunspell = loadDictionary();
+   }
+
+   QStringList addedWords;
 
-      for (QString word(stream.readLine()); ! word.isEmpty(); word = stream.readLine()) {
-         put_word(word);
+   {
+      QMutexLocker lock(&m_mutex);
+
+      addedWords.swap(m_addedWords);
+      m_workerRevision = m_dictRevision.load();
+   }
+
+   for (const auto &word : addedWords) {
+      m_workerHunspell->add(m_codec->fromUnicode(word).constData());
+   }
+}
+
+void SpellCheck::runBatch(QSharedPointer<SpellBatch> batch)
+{
+   prepareWorker();
+
+   // one sample per batch, only collected while the profiler is enabled
+   const bool profile = SyntaxProfiler::isEnabled();
+
+   SyntaxProfileSample sample{SYN_FORMAT_SPELL, "hunspell", 0, 0, 0, 0};
+   QElapsedTimer clock;
+
+   if (profile) {
+      clock.start();
+   }
+
+   for (auto &block : batch->blocks) {
+
+      {
+         QMutexLocker lock(&batch->mutex);
+
+         if (batch->receiver == nullptr) {
+            break;
+         }
       }
 
-      file.close();
+      const QString &text = block.text;
+      QTextBoundaryFinder wordFinder(QTextBoundaryFinder::Word, text);
+
+      for (const auto &range : block.ranges) {
+         const int end = range.first + range.second;
+
+         wordFinder.setPosition(range.first);
+
+         while (wordFinder.position() < end) {
+            int wordStart  = wordFinder.position();
+            int wordLength = qMin(wordFinder.toNextBoundary(), end) - wordStart;
+
+            if (wordLength <= 0) {
+               break;
+            }
+
+            QStringView word = text.midView(wordStart, wordLength).trimmed();
+
+            const bool isCorrect = lookUpWord(word);
+
+            if (! isCorrect) {
+               block.misspelled.append(qMakePair(wordStart, wordLength));
+            }
+
+            if (profile) {
+               ++sample.invocations;
+               sample.matches += isCorrect ? 0 : 1;
+            }
+         }
+      }
+   }
+
+   if (profile) {
+      sample.nsecs = clock.nsecsElapsed();
+      SyntaxProfiler::record(batch->fileName, QVector<SyntaxProfileSample>{sample});
+   }
+
+   QMutexLocker lock(&batch->mutex);
+
+   if (batch->receiver != nullptr) {
+      QCoreApplication::postEvent(batch->receiver, new SpellResultEvent(batch));
    }
 }
 
-SpellCheck::~SpellCheck()
+bool SpellCheck::get_Suggestions(const QString &word, QStringList &list)
 {
-   delete m_hunspell;
+   QMutexLocker lock(&m_cacheMutex);
+
+   auto iter = m_suggestCache.constFind(word);
+
+   if (iter == m_suggestCache.constEnd()) {
+      return false;
+   }
+
+   list = iter.value();
+
+   return true;
+}
+
+void SpellCheck::suggestAsync(const QString &word, QObject *receiver)
+{
+   {
+      QMutexLocker lock(&m_cacheMutex);
+
+      // replaces a request which has not started yet
+      m_suggestWord     = word;
+      m_suggestReceiver = receiver;
+   }
+
+   // ahead of queued spell batches, the user is waiting for the menu
+   m_pool.start(new SpellTask([this] () { runSuggest(); } ), 1);
+}
+
+void SpellCheck::cancelSuggest(QObject *receiver)
+{
+   QMutexLocker lock(&m_cacheMutex);
+
+   if (m_suggestReceiver == receiver) {
+      m_suggestWord.clear();
+      m_suggestReceiver = nullptr;
+   }
 }
 
-bool SpellCheck::spell(QStringView word)
+void SpellCheck::runSuggest()
 {
-   bool isCorrect;
+   QString word;
+
+   {
+      QMutexLocker lock(&m_cacheMutex);
+      word = m_suggestWord;
+   }
 
    if (word.isEmpty()) {
-      return true;
+      // cancelled or answered by an earlier task
+      return;
    }
 
-   QString lookUp(word);
+   QStringList list;
 
-   while (! lookUp.isEmpty() && ! lookUp.at(0).isLetter()) {
-      lookUp = lookUp.mid(1);
+   if (! get_Suggestions(word, list)) {
+      prepareWorker();
+
+      const QByteArray ba = m_codec->fromUnicode(word);
+      const std::string checkWord = ba.constData();
+
+      // may take a while for long compound words, the GUI thread is not blocked
+      std::vector<std::string> suggestWords = m_workerHunspell->suggest(checkWord);
+
+      for (const auto &item : suggestWords) {
+         list.append(m_codec->toUnicode(item.c_str()));
+      }
    }
 
-   const QByteArray ba = m_codec->fromUnicode(lookUp);
-   const std::string checkWord = ba.constData();
+   QMutexLocker lock(&m_cacheMutex);
 
-   isCorrect = m_hunspell->spell(checkWord) != 0;
+   if (m_suggestCache.size() >= SUGGEST_LIMIT) {
+      m_suggestCache.clear();
+   }
 
-   return isCorrect;
+   m_suggestCache.insert(word, list);
+
+   if (m_suggestWord == word) {
+      if (m_suggestReceiver != nullptr) {
+         QCoreApplication::postEvent(m_suggestReceiver, new SpellSuggestEvent(word, list));
+      }
+
+      m_suggestWord.clear();
+      m_suggestReceiver = nullptr;
+   }
 }
 
-QStringList SpellCheck::suggest(const QString &word)
+Hunspell *SpellCheck::loadDictionary()
 {
-   QStringList retval;
+   // main dictionary and the words saved in the user dictionary
+   Hunspell *retval = new Hunspell(m_affFName.constData(), m_dicFName.constData());
 
-   std::vector<std::string> suggestWords;
+   if (m_userFname.isEmpty()) {
+      return retval;
+   }
 
-   const QByteArray ba = m_codec->fromUnicode(word);
-   const std::string checkWord = ba.constData();
+   QFile file(m_userFname);
+
+   if (! file.open(QFile::ReadOnly)) {
+      // reported when spell check was created
+      return retval;
+   }
 
-   suggestWords = m_hunspell->suggest(checkWord);
+   QTextStream stream(&file);
 
-   for (const auto &item : suggestWords) {
-      retval.append(m_codec->toUnicode(item.c_str()));
+   for (QString word(stream.readLine()); ! word.isEmpty(); word = stream.readLine()) {
+      retval->add(m_codec->fromUnicode(word).constData());
    }
 
+   file.close();
+
    return retval;
 }
 
+bool SpellCheck::lookUpWord(QStringView word)
+{
+   // runs on the worker thread, the lock is not held during the lookup
+   if (word.isEmpty()) {
+      return true;
+   }
+
+   QString key(word);
+
+   {
+      QMutexLocker lock(&m_cacheMutex);
+
+      auto iter = m_cache.constFind(key);
+
+      if (iter != m_cache.constEnd()) {
+         ++m_cacheHits;
+         return iter.value();
+      }
+
+      ++m_cacheMisses;
+   }
+
+   const QString lookUp = stripWord(key);
+
+   if (lookUp.isEmpty()) {
+      return true;
+   }
+
+   const QByteArray ba = m_codec->fromUnicode(lookUp);
+
+   // only this thread opens the snapshot, no lock is needed to read it
+   bool isCorrect = m_snapshot.contains(ba);
+
+   if (! isCorrect) {
+      // affix forms, user words and misspellings
+      const std::string checkWord = ba.constData();
+      isCorrect = m_workerHunspell->spell(checkWord) != 0;
+   }
+
+   QMutexLocker lock(&m_cacheMutex);
+
+   if (m_workerRevision == m_dictRevision.load()) {
+      // words added after this batch started are not in the worker dictionary yet
+
+      if (m_cache.size() >= CACHE_LIMIT) {
+         m_cache.clear();
+      }
+
+      m_cache.insert(key, isCorrect);
+   }
+
+   return isCorrect;
+}
+
 void SpellCheck::ignoreWord(const QString &word)
 {
    put_word(word);
@@ -121,7 +440,31 @@ void SpellCheck::ignoreWord(const QString &word)
 
 void SpellCheck::put_word(const QString &word)
 {
-   m_hunspell->add(m_codec->fromUnicode(word).constData());
+   QMutexLocker lock(&m_mutex);
+
+   // applied to the worker dictionary when the next batch runs
+   m_addedWords.append(word);
+   ++m_dictRevision;
+
+   lock.unlock();
+
+   // cached misspellings may now be correct
+   QMutexLocker cacheLock(&m_cacheMutex);
+
+   m_cache.clear();
+   m_suggestCache.clear();
+}
+
+qint64 SpellCheck::get_CacheHits()
+{
+   QMutexLocker lock(&m_cacheMutex);
+   return m_cacheHits;
+}
+
+qint64 SpellCheck::get_CacheMisses()
+{
+   QMutexLocker lock(&m_cacheMutex);
+   return m_cacheMisses;
 }
 
 void SpellCheck::addToUserDict(const QString &word)
@@ -17,28 +17,142 @@
 #ifndef SPELLCHECK_H
 #define SPELLCHECK_H
 
+#include "spell_snapshot.h"
+
+#include <QEvent>
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QSharedPointer>
 #include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+#include <atomic>
 
 class Hunspell;
 
+// text of one block sent to the spell check worker
+struct SpellBlock
+{
+   int blockNumber;
+   int revision;
+   QString text;
+
+   // parts of the text to check and the misspelled words found, as (start, length)
+   QVector<QPair<int, int>> ranges;
+   QVector<QPair<int, int>> misspelled;
+};
+
+struct SpellBatch
+{
+   // dictionary revision when the batch was created
+   int dictRevision = 0;
+
+   // syntax file of the document, names the profiler entry
+   QString fileName;
+
+   QVector<SpellBlock> blocks;
+
+   // cleared by the receiver when it no longer wants the result
+   QMutex mutex;
+   QObject *receiver = nullptr;
+};
+
+class SpellResultEvent : public QEvent
+{
+   public:
+      SpellResultEvent(QSharedPointer<SpellBatch> batch)
+         : QEvent(eventType()), m_batch(batch)
+      { }
+
+      static QEvent::Type eventType();
+
+      QSharedPointer<SpellBatch> m_batch;
+};
+
+class SpellSuggestEvent : public QEvent
+{
+   public:
+      SpellSuggestEvent(const QString &word, const QStringList &suggestions)
+         : QEvent(eventType()), m_word(word), m_suggestions(suggestions)
+      { }
+
+      static QEvent::Type eventType();
+
+      QString m_word;
+      QStringList m_suggestions;
+};
+
 class SpellCheck
 {
    public:
       SpellCheck(const QString &dictMain, const QString &dictUser);
       ~SpellCheck();
 
-      bool spell(QStringView word);
-      QStringList suggest(const QString &word);
+      // checks the batch on the worker thread, a SpellResultEvent is posted to the receiver when done
+      void spellBatch(QSharedPointer<SpellBatch> batch);
+      static void cancelBatch(QSharedPointer<SpellBatch> batch);
+
+      // suggestions from the cache, false when they have not been computed yet
+      bool get_Suggestions(const QString &word, QStringList &list);
+
+      // computes suggestions on the worker thread, a SpellSuggestEvent is posted to the receiver
+      void suggestAsync(const QString &word, QObject *receiver);
+      void cancelSuggest(QObject *receiver);
+
+      // incremented each time a word is added to the dictionary
+      int get_DictRevision() const;
+
       void ignoreWord(const QString &word);
       void addToUserDict(const QString &word);
 
+      // word cache statistics
+      qint64 get_CacheHits();
+      qint64 get_CacheMisses();
+
    private:
       void put_word(const QString &word);
+      Hunspell *loadDictionary();
+      void prepareWorker();
+      void runBatch(QSharedPointer<SpellBatch> batch);
+      void runSuggest();
+      bool lookUpWord(QStringView word);
 
       QString m_userFname;
+      QString m_affFName;
+      QString m_dicFName;
+      QString m_snapshotFName;
       QTextCodec *m_codec;
 
-      Hunspell *m_hunspell;
+      // guards the snapshot while it is opened and the added words
+      QMutex m_mutex;
+
+      // stem words of the main dictionary, checked before Hunspell
+      SpellSnapshot m_snapshot;
+
+      // guards the caches and the suggestion request, never held during a lookup
+      QMutex m_cacheMutex;
+
+      // result of each word checked by the worker, cleared when the dictionary changes
+      QHash<QString, bool> m_cache;
+      qint64 m_cacheHits;
+      qint64 m_cacheMisses;
+
+      // latest suggestion request and the results for each word
+      QString m_suggestWord;
+      QObject *m_suggestReceiver;
+      QHash<QString, QStringList> m_suggestCache;
+
+      // words added since the worker last ran, applied to the worker dictionary before the next task
+      QStringList m_addedWords;
+      std::atomic<int> m_dictRevision;
+      int m_workerRevision;
+
+      // the only dictionary, loaded and used on the worker thread so typing never waits for a lookup
+      QThreadPool m_pool;
+      Hunspell *m_workerHunspell;
 };
 
 #endif
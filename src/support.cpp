@@ -86,6 +86,10 @@ void MainWindow::closeEvent(QCloseEvent *event)
 
    if (exit) {
       json_Write(CLOSE);
+
+      // waits for an index update which is still running
+      m_advFindIndex.reset();
+
       event->accept();
 
    } else {
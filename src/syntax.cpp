@@ -16,15 +16,236 @@
 
 #include "spellcheck.h"
 #include "syntax.h"
+#include "syntax_profiler.h"
 #include "util.h"
 
+#include <QCoreApplication>
+#include <QElapsedTimer>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonValue>
-#include <QTextBoundaryFinder>
+#include <QRunnable>
+#include <QTextDocument>
 
-static const QRegularExpression DEFAULT_COMMENT = QRegularExpression("(?!E)E");
+#include <algorithm>
+
+static const QString DEFAULT_COMMENT = "(?!E)E";
+
+// background highlighting, time budget of one slice and the pause after an edit (ms)
+static constexpr const int SLICE_BUDGET = 8;
+static constexpr const int IDLE_DELAY   = 250;
+
+// number of blocks sent to the worker in one job
+static constexpr const int JOB_BLOCKS   = 2000;
+
+// number of blocks sent to the spell check worker in one batch
+static constexpr const int SPELL_BLOCKS = 200;
+
+static const QEvent::Type SYNTAX_RESULT_EVENT = static_cast<QEvent::Type>(QEvent::registerEventType());
+
+// block text snapshot sent to the worker thread and the format runs it returns
+struct SyntaxJob
+{
+   int id;
+   int generation;
+   int editCount;
+   int firstBlock;
+   int previousState;
+
+   QVector<QString> texts;
+   QVector<int> revisions;
+
+   QVector<QVector<SyntaxRun>> runs;
+   QVector<int> states;
+};
+
+class SyntaxResultEvent : public QEvent
+{
+   public:
+      SyntaxResultEvent(QSharedPointer<SyntaxJob> job)
+         : QEvent(SYNTAX_RESULT_EVENT), m_job(job)
+      { }
+
+      QSharedPointer<SyntaxJob> m_job;
+};
+
+class SyntaxTask : public QRunnable
+{
+   public:
+      SyntaxTask(Syntax *syntax, QSharedPointer<const SyntaxRules> rules,
+            QSharedPointer<SyntaxJob> job, std::atomic<int> *jobId)
+         : m_syntax(syntax), m_rules(rules), m_job(job), m_jobId(jobId)
+      { }
+
+      void run() override;
+
+   private:
+      Syntax *m_syntax;
+      QSharedPointer<const SyntaxRules> m_rules;
+      QSharedPointer<SyntaxJob> m_job;
+      std::atomic<int> *m_jobId;
+};
+
+void SyntaxTask::run()
+{
+   SyntaxJob &job = *m_job;
+
+   int count = job.texts.size();
+   int state = job.previousState;
+
+   job.runs.resize(count);
+   job.states.resize(count);
+
+   for (int k = 0; k < count; ++k) {
+
+      if (m_jobId->load() != job.id) {
+         // cancelled by an edit or a new highlight pass
+         return;
+      }
+
+      state = Syntax::tokenize(*m_rules, job.texts[k], state, job.runs[k]);
+      job.states[k] = state;
+   }
+
+   // Syntax waits for this task in its destructor, the pointer is valid
+   QCoreApplication::postEvent(m_syntax, new SyntaxResultEvent(m_job));
+}
+
+static int nextGeneration()
+{
+   // unique across every Syntax, blocks may keep data from a previous highlighter
+   static int generation = 0;
+
+   return ++generation;
+}
+
+static bool isWordChar(QChar c)
+{
+   return c.isLetterOrNumber() || c == '_';
+}
+
+// returns the index after the character class which starts at pos
+static int skipClass(const QVector<QChar> &chars, int pos)
+{
+   const int size = chars.size();
+   int k = pos + 1;
+
+   if (k < size && chars[k] == '^') {
+      ++k;
+   }
+
+   if (k < size && chars[k] == ']') {
+      ++k;
+   }
+
+   while (k < size && chars[k] != ']') {
+
+      if (chars[k] == '\\') {
+         k += 2;
+
+      } else if (chars[k] == '[' && k + 1 < size && chars[k + 1] == ':') {
+         // posix class such as [:alpha:]
+         k += 2;
+
+         while (k < size && chars[k] != ']') {
+            ++k;
+         }
+
+         ++k;
+
+      } else {
+         ++k;
+      }
+   }
+
+   return k + 1;
+}
+
+// returns the index after the group which starts at pos
+static int skipGroup(const QVector<QChar> &chars, int pos)
+{
+   const int size = chars.size();
+
+   int depth = 0;
+   int k     = pos;
+
+   while (k < size) {
+      QChar c = chars[k];
+
+      if (c == '\\') {
+         k += 2;
+         continue;
+      }
+
+      if (c == '[') {
+         k = skipClass(chars, k);
+         continue;
+      }
+
+      if (c == '(') {
+         ++depth;
+
+      } else if (c == ')') {
+         --depth;
+
+         if (depth == 0) {
+            return k + 1;
+         }
+      }
+
+      ++k;
+   }
+
+   return size;
+}
+
+// ascii characters present in a block of text, letters are folded to lower case
+static void markChar(quint64 *bits, QChar c)
+{
+   char32_t value = c.unicode();
+
+   if (value < 128) {
+      if (value >= 'A' && value <= 'Z') {
+         value += 'a' - 'A';
+      }
+
+      bits[value >> 6] |= quint64(1) << (value & 63);
+   }
+}
+
+static bool hasChar(const quint64 *bits, QChar c)
+{
+   char32_t value = c.unicode();
+
+   if (value >= 128) {
+      // not tracked
+      return true;
+   }
+
+   if (value >= 'A' && value <= 'Z') {
+      value += 'a' - 'A';
+   }
+
+   return (bits[value >> 6] & (quint64(1) << (value & 63))) != 0;
+}
+
+// false when a required literal is missing, the regular expression can not match
+static bool canMatch(const SyntaxPattern &pattern, const QString &text, const quint64 *blockChars)
+{
+   for (const auto &literal : pattern.literals) {
+
+      if (! hasChar(blockChars, literal[0])) {
+         return false;
+      }
+
+      if (! text.contains(literal, pattern.ignoreCase ? Qt::CaseInsensitive : Qt::CaseSensitive)) {
+         return false;
+      }
+   }
+
+   return true;
+}
 
 Syntax::Syntax(QTextDocument *document, QString synFName, const struct Settings &settings, SpellCheck *spell)
    : QSyntaxHighlighter(document)
@@ -34,175 +255,386 @@ Syntax::Syntax(QTextDocument *document, QString synFName, const struct Settings
    m_spellCheck   = spell;
 
    m_isSpellCheck = settings.isSpellCheck;
+
+   m_generation   = nextGeneration();
+   m_palette      = 0;
+   m_nextBlock    = 0;
+   m_blockCount   = document->blockCount();
+   m_firstVisible = 0;
+   m_lastVisible  = -1;
+   m_forceBlockNumber = -1;
+   m_formatting   = false;
+   m_inVisible    = false;
+
+   m_jobId        = 0;
+   m_editCount    = 0;
+   m_resultIndex  = 0;
+
+   m_spellGeneration = nextGeneration();
+   m_nextSpellBlock  = 0;
+
+   m_sliceTimer.setSingleShot(true);
+
+   // one worker per document keeps the blocks in order
+   m_pool.setMaxThreadCount(1);
+
+   connect(&m_sliceTimer, &QTimer::timeout, this, &Syntax::highlightSlice);
+   connect(document, &QTextDocument::contentsChange, this, &Syntax::documentChanged);
+}
+
+Syntax::~Syntax()
+{
+   disconnect(document(), &QTextDocument::contentsChange, this, &Syntax::documentChanged);
+
+   cancelJob();
+   m_pool.waitForDone();
+
+   cancelSpell();
 }
 
 bool Syntax::processSyntax(const struct Settings &settings)
 {
-   // only called from Dialog_Colors
+   // only called when colors change, the rules are unchanged so the cached runs are repainted
    m_settings = settings;
 
-   return processSyntax();
+   if (m_rules == nullptr) {
+      return processSyntax();
+   }
+
+   setFormats();
+   repaintDocument();
+
+   return true;
 }
 
 bool Syntax::processSyntax()
+{
+   // compiled rules are shared by every tab using the same syntax file
+   m_rules = SyntaxRegistry::getRules(m_syntaxFile);
+
+   if (m_rules == nullptr) {
+      return false;
+   }
+
+   setFormats();
+
+   // redo the current document
+   rehighlightDocument();
+
+   return true;
+}
+
+void Syntax::setFormats()
+{
+   m_formats.resize(SYN_FORMAT_COUNT);
+
+   // key
+   m_formats[SYN_GROUP_KEY].setFontWeight(m_settings.syn_KeyWeight);
+   m_formats[SYN_GROUP_KEY].setFontItalic(m_settings.syn_KeyItalic);
+   m_formats[SYN_GROUP_KEY].setForeground(m_settings.syn_KeyText);
+
+   // class
+   m_formats[SYN_GROUP_CLASS].setFontWeight(m_settings.syn_ClassWeight);
+   m_formats[SYN_GROUP_CLASS].setFontItalic(m_settings.syn_ClassItalic);
+   m_formats[SYN_GROUP_CLASS].setForeground(m_settings.syn_ClassText);
+
+   // func
+   m_formats[SYN_GROUP_FUNC].setFontWeight(m_settings.syn_FuncWeight);
+   m_formats[SYN_GROUP_FUNC].setFontItalic(m_settings.syn_FuncItalic);
+   m_formats[SYN_GROUP_FUNC].setForeground(m_settings.syn_FuncText);
+
+   // types
+   m_formats[SYN_GROUP_TYPE].setFontWeight(m_settings.syn_TypeWeight);
+   m_formats[SYN_GROUP_TYPE].setFontItalic(m_settings.syn_TypeItalic);
+   m_formats[SYN_GROUP_TYPE].setForeground(m_settings.syn_TypeText);
+
+   // quoted text
+   m_formats[SYN_GROUP_QUOTE].setFontWeight(m_settings.syn_QuoteWeight);
+   m_formats[SYN_GROUP_QUOTE].setFontItalic(m_settings.syn_QuoteItalic);
+   m_formats[SYN_GROUP_QUOTE].setForeground(m_settings.syn_QuoteText);
+
+   // single line comment
+   m_formats[SYN_GROUP_COMMENT].setFontWeight(m_settings.syn_CommentWeight);
+   m_formats[SYN_GROUP_COMMENT].setFontItalic(m_settings.syn_CommentItalic);
+   m_formats[SYN_GROUP_COMMENT].setForeground(m_settings.syn_CommentText);
+
+   // multi line comment
+   m_formats[SYN_FORMAT_MLCOMMENT].setFontWeight(m_settings.syn_MLineWeight);
+   m_formats[SYN_FORMAT_MLCOMMENT].setFontItalic(m_settings.syn_MLineItalic);
+   m_formats[SYN_FORMAT_MLCOMMENT].setForeground(m_settings.syn_MLineText);
+
+   // spell check
+   m_formats[SYN_FORMAT_SPELL].setUnderlineColor(QColor(Qt::red));
+
+   // pending
+   // m_formats[SYN_FORMAT_SPELL].setUnderlineStyle(QTextCharFormat::SpellCheckUnderline);
+   m_formats[SYN_FORMAT_SPELL].setUnderlineStyle(QTextCharFormat::WaveUnderline);
+}
+
+QSharedPointer<const SyntaxRules> Syntax::compileRules(const QString &fileName)
 {
    // get existing json data
-   QByteArray jsonData = json_ReadFile(m_syntaxFile);
+   QByteArray jsonData = json_ReadFile(fileName);
 
    if (jsonData.isEmpty()) {
-      return false;
+      return QSharedPointer<const SyntaxRules>();
    }
 
    QJsonDocument doc = QJsonDocument::fromJson(jsonData);
 
    QJsonObject object = doc.object();
-   QJsonArray list;
 
-   bool ignoreCase = object.value("ignore-case").toBool();
+   QSharedPointer<SyntaxRules> rules(new SyntaxRules);
 
-   // key
-   QStringList key_Patterns;
-   list = object.value("keywords").toArray();
+   rules->fileName   = fileName;
+   rules->ignoreCase = object.value("ignore-case").toBool();
+   rules->spellAllText = object.value("spell-all-text").toBool();
+   rules->groupPatterns.resize(SYN_GROUP_COUNT);
 
-   for (const auto &item : list) {
-      key_Patterns.append(item.toString());
-   }
+   addRuleGroup(rules.data(), SYN_GROUP_KEY,   object.value("keywords").toArray());
+   addRuleGroup(rules.data(), SYN_GROUP_CLASS, object.value("classes").toArray());
+   addRuleGroup(rules.data(), SYN_GROUP_FUNC,  object.value("functions").toArray());
+   addRuleGroup(rules.data(), SYN_GROUP_TYPE,  object.value("types").toArray());
 
-   // class
-   QStringList class_Patterns;
-   list = object.value("classes").toArray();
+   // quoted text
+   rules->groupPatterns[SYN_GROUP_QUOTE].append(compilePattern("\".*?\"", false));
 
-   for (const auto &item : list) {
-      class_Patterns.append(item.toString());
+   // single line comment, an empty pattern matches at every position and would be tried for each character
+   QString commentSingle = object.value("comment-single").toString();
+
+   if (! commentSingle.isEmpty()) {
+      rules->groupPatterns[SYN_GROUP_COMMENT].append(compilePattern(commentSingle, false));
    }
 
-   // functions
-   QStringList func_Patterns;
-   list = object.value("functions").toArray();
+   // multi line comment
+   QString commentStart = object.value("comment-multi-start").toString();
+   QString commentEnd   = object.value("comment-multi-end").toString();
 
-   for (const auto &item : list) {
-      func_Patterns.append(item.toString());
+   if (commentStart.isEmpty()) {
+      commentStart = DEFAULT_COMMENT;
    }
 
-   // types
-   QStringList type_Patterns;
-   list = object.value("types").toArray();
-
-   for (const auto &item : list) {
-      type_Patterns.append(item.toString());
+   if (commentEnd.isEmpty()) {
+      commentEnd = DEFAULT_COMMENT;
    }
 
-   HighlightingRule rule;
+   rules->commentStart = compilePattern(commentStart, false);
+   rules->commentEnd   = compilePattern(commentEnd, false);
 
-   // key
-   rule.format.setFontWeight(m_settings.syn_KeyWeight);
-   rule.format.setFontItalic(m_settings.syn_KeyItalic);
-   rule.format.setForeground(m_settings.syn_KeyText);
+   return rules;
+}
+
+void Syntax::addRuleGroup(SyntaxRules *rules, SyntaxGroup group, const QJsonArray &list)
+{
+   const uint groupBit = 1u << group;
 
-   for (const QString &item : key_Patterns) {
-      if (item.trimmed().isEmpty()) {
+   for (const auto &item : list) {
+      QString pattern = item.toString();
+
+      if (pattern.trimmed().isEmpty()) {
          continue;
       }
 
-      rule.pattern = QRegularExpression(item);
+      QString word;
+
+      if (isPlainWord(pattern, word)) {
+         // matched by the identifier scanner in tokenize()
+         if (rules->ignoreCase) {
+            word = word.toCaseFolded();
+         }
 
-      if (ignoreCase) {
-         rule.pattern.setPatternOptions(QPatternOption::CaseInsensitiveOption);
+         rules->wordList[word] |= groupBit;
+         continue;
       }
-      highlightingRules.append(rule);
+
+      rules->groupPatterns[group].append(compilePattern(pattern, rules->ignoreCase));
    }
+}
 
-   // class
-   rule.format.setFontWeight(m_settings.syn_ClassWeight);
-   rule.format.setFontItalic(m_settings.syn_ClassItalic);
-   rule.format.setForeground(m_settings.syn_ClassText);
+SyntaxPattern Syntax::compilePattern(const QString &pattern, bool ignoreCase)
+{
+   SyntaxPattern retval;
 
-   for (const QString &item : class_Patterns) {
-      if (item.trimmed().isEmpty()) {
-         continue;
-      }
+   retval.regExp     = QRegularExpression(pattern);
+   retval.literals   = requiredLiterals(pattern);
+   retval.ignoreCase = ignoreCase;
+
+   if (ignoreCase) {
+      retval.regExp.setPatternOptions(QPatternOption::CaseInsensitiveOption);
+   }
 
-      rule.pattern = QRegularExpression(item);
+   return retval;
+}
 
-      if (ignoreCase) {
-         rule.pattern.setPatternOptions(QPatternOption::CaseInsensitiveOption);
-      }
-      highlightingRules.append(rule);
+bool Syntax::isPlainWord(const QString &pattern, QString &word)
+{
+   // accepts \bword\b, the lookarounds for '_' used in some syntax files are redundant since '_' is a word character
+   QString tmp = pattern;
+
+   if (! tmp.startsWith("\\b")) {
+      return false;
    }
 
-   // func
-   rule.format.setFontWeight(m_settings.syn_FuncWeight);
-   rule.format.setFontItalic(m_settings.syn_FuncItalic);
-   rule.format.setForeground(m_settings.syn_FuncText);
+   tmp = tmp.mid(2);
 
-   for (const QString &item : func_Patterns) {
-      if (item.trimmed().isEmpty()) {
-         continue;
-      }
+   if (tmp.startsWith("(?<!_)")) {
+      tmp = tmp.mid(6);
+   }
 
-      rule.pattern = QRegularExpression(item);
+   if (tmp.endsWith("(?!_)")) {
+      tmp.chop(5);
+   }
 
-      if (ignoreCase) {
-         rule.pattern.setPatternOptions(QPatternOption::CaseInsensitiveOption);
-      }
-      highlightingRules.append(rule);
+   if (! tmp.endsWith("\\b")) {
+      return false;
    }
 
-   // types
-   rule.format.setFontWeight(m_settings.syn_TypeWeight);
-   rule.format.setFontItalic(m_settings.syn_TypeItalic);
-   rule.format.setForeground(m_settings.syn_TypeText);
+   tmp.chop(2);
 
-   for (const QString &item : type_Patterns) {
-      if (item.trimmed().isEmpty()) {
-         continue;
+   if (tmp.isEmpty()) {
+      return false;
+   }
+
+   for (QChar c : tmp) {
+      if (! isWordChar(c)) {
+         return false;
       }
+   }
+
+   word = tmp;
 
-      rule.pattern = QRegularExpression(item);
+   return true;
+}
+
+QStringList Syntax::requiredLiterals(const QString &pattern)
+{
+   // literal text outside of groups, classes and optional atoms must appear in every match
+   QStringList retval;
+
+   QVector<QChar> chars;
+
+   for (QChar c : pattern) {
+      chars.append(c);
+   }
+
+   const int size = chars.size();
+
+   // an alternation at the top level or an inline option makes the literals unreliable
+   int depth = 0;
+
+   for (int k = 0; k < size; ++k) {
+      QChar c = chars[k];
+
+      if (c == '\\') {
+         ++k;
+
+      } else if (c == '[') {
+         k = skipClass(chars, k) - 1;
+
+      } else if (c == '(') {
+         ++depth;
+
+         if (k + 2 < size && chars[k + 1] == '?' && (chars[k + 2].isLetter() || chars[k + 2] == '-' || chars[k + 2] == '^')) {
+            return retval;
+         }
+
+      } else if (c == ')') {
+         --depth;
 
-      if (ignoreCase) {
-         rule.pattern.setPatternOptions(QPatternOption::CaseInsensitiveOption);
+      } else if (c == '|' && depth == 0) {
+         return retval;
       }
-      highlightingRules.append(rule);
    }
 
-   // quoted text
-   rule.format.setFontWeight(m_settings.syn_QuoteWeight);
-   rule.format.setFontItalic(m_settings.syn_QuoteItalic);
-   rule.format.setForeground(m_settings.syn_QuoteText);
-   rule.pattern = QRegularExpression("\".*?\"");
-   highlightingRules.append(rule);
+   // escapes which are a single character class or assertion
+   static const QString simpleEscapes = "bBdDsSwWhHvVRAzZGntrfea";
 
-   // single line comment
-   QString commentSingle = object.value("comment-single").toString();
+   QString current;
+   int k = 0;
 
-   rule.format.setFontWeight(m_settings.syn_CommentWeight);
-   rule.format.setFontItalic(m_settings.syn_CommentItalic);
-   rule.format.setForeground(m_settings.syn_CommentText);
-   rule.pattern = QRegularExpression(commentSingle);
-   highlightingRules.append(rule);
+   while (k < size) {
+      QChar c = chars[k];
+      QChar literal;
 
-   // multi line comment
-   QString commentStart = object.value("comment-multi-start").toString();
-   QString commentEnd   = object.value("comment-multi-end").toString();
+      int next = k + 1;
 
-   m_multiLineCommentFormat.setFontWeight(m_settings.syn_MLineWeight);
-   m_multiLineCommentFormat.setFontItalic(m_settings.syn_MLineItalic);
-   m_multiLineCommentFormat.setForeground(m_settings.syn_MLineText);
-   m_commentStartExpression = QRegularExpression(commentStart);
-   m_commentEndExpression   = QRegularExpression(commentEnd);
+      if (c == '\\') {
+         if (next >= size) {
+            break;
+         }
 
-   // spell check
-   m_spellCheckFormat.setUnderlineColor(QColor(Qt::red));
+         QChar escaped = chars[next];
+         ++next;
 
-   // pending
-   // m_spellCheckFormat.setUnderlineStyle(QTextCharFormat::SpellCheckUnderline);
-   m_spellCheckFormat.setUnderlineStyle(QTextCharFormat::WaveUnderline);
+         if (! escaped.isLetterOrNumber()) {
+            literal = escaped;
 
-   // redo the current document
-   rehighlight();
+         } else if (! simpleEscapes.contains(escaped)) {
+            // \x, \p, \Q, back references and similar are not parsed
+            return QStringList();
+         }
 
-   return true;
+      } else if (c == '[') {
+         next = skipClass(chars, k);
+
+      } else if (c == '(') {
+         next = skipGroup(chars, k);
+
+      } else if (c != '.' && c != '^' && c != '$' && c != ')' && c != '|') {
+         literal = c;
+      }
+
+      // quantifier which applies to this atom
+      bool optional = false;
+      bool repeated = false;
+
+      if (next < size) {
+         QChar quantifier = chars[next];
+
+         if (quantifier == '?' || quantifier == '*') {
+            optional = true;
+            ++next;
+
+         } else if (quantifier == '+') {
+            repeated = true;
+            ++next;
+
+         } else if (quantifier == '{' && next + 1 < size && chars[next + 1].isDigit()) {
+            optional = (chars[next + 1] == '0');
+            repeated = true;
+
+            while (next < size && chars[next] != '}') {
+               ++next;
+            }
+
+            ++next;
+         }
+
+         if ((optional || repeated) && next < size && (chars[next] == '?' || chars[next] == '+')) {
+            // lazy or possessive
+            ++next;
+         }
+      }
+
+      if (! literal.isNull() && ! optional) {
+         current.append(literal);
+      }
+
+      if (literal.isNull() || optional || repeated) {
+         if (! current.isEmpty()) {
+            retval.append(current);
+            current.clear();
+         }
+      }
+
+      k = next;
+   }
+
+   if (! current.isEmpty()) {
+      retval.append(current);
+   }
+
+   return retval;
 }
 
 QByteArray Syntax::json_ReadFile(QString fileName)
@@ -238,75 +670,893 @@ QByteArray Syntax::json_ReadFile(QString fileName)
 void Syntax::set_Spell(bool value)
 {
    m_isSpellCheck = value;
+   resetSpell();
 }
 
-void Syntax::highlightBlock(const QString &text)
+void Syntax::set_SpellComments(bool value)
 {
-   QRegularExpressionMatch match;
+   m_settings.spellComments = value;
+   resetSpell();
+}
 
-   for (auto &rule : highlightingRules) {
-      match = rule.pattern.match(text);
+void Syntax::resetSpell()
+{
+   // previous results are discarded, the underline is added or removed without matching again
+   m_spellGeneration = nextGeneration();
+   m_nextSpellBlock  = 0;
 
-      while (match.hasMatch()) {
-         int index  = match.capturedStart(0) - text.begin();
-         int length = match.capturedLength();
+   cancelSpell();
+   repaintDocument();
+}
 
-         setFormat(index, length, rule.format);
+void Syntax::set_VisibleBlocks(int first, int last)
+{
+   m_firstVisible = first;
+   m_lastVisible  = last;
 
-         // get new match
-         match = rule.pattern.match(text, match.capturedEnd(0));
-      }
-   }
+   highlightVisible();
+}
 
-   // multi line comments
-   setCurrentBlockState(0);
+void Syntax::rehighlightDocument()
+{
+   // every block is now out of date
+   m_generation = nextGeneration();
+   m_nextBlock = 0;
 
-   int startIndex = 0;
+   cancelJob();
 
-   if (m_commentStartExpression.pattern().isEmpty()) {
-      m_commentStartExpression = DEFAULT_COMMENT;
-   }
+   highlightVisible();
+   m_sliceTimer.start(0);
+}
 
-   if (m_commentEndExpression.pattern().isEmpty()) {
-      m_commentEndExpression = DEFAULT_COMMENT;
+SpellCheck *Syntax::activeSpellCheck() const
+{
+   if (m_isSpellCheck) {
+      return m_spellCheck;
    }
 
-   if (previousBlockState() != 1) {
-      startIndex = text.indexOf(m_commentStartExpression);
+   return nullptr;
+}
+
+SyntaxBlockData *Syntax::blockData(QTextBlock &block)
+{
+   SyntaxBlockData *data = dynamic_cast<SyntaxBlockData *>(block.userData());
+
+   if (data == nullptr) {
+      data = new SyntaxBlockData;
+      block.setUserData(data);
    }
 
-   while (startIndex >= 0) {
-      int commentLength;
-      match = m_commentEndExpression.match(text, text.begin() + startIndex);
+   return data;
+}
 
-      if (match.hasMatch()) {
-         int endIndex  = match.capturedStart(0) - text.begin();
-         commentLength = endIndex - startIndex + match.capturedLength();
+void Syntax::repaintDocument()
+{
+   // new palette, the format runs are still valid
+   ++m_palette;
+   m_nextBlock = 0;
+
+   // a running job would move m_nextBlock past the blocks above it when its result is applied
+   cancelJob();
+
+   highlightVisible();
+   m_sliceTimer.start(0);
+}
+
+bool Syntax::needsPaint(const QTextBlock &block) const
+{
+   SyntaxBlockData *data = dynamic_cast<SyntaxBlockData *>(block.userData());
+
+   return data != nullptr && data->palette != m_palette;
+}
+
+bool Syntax::isMisspelled(const QTextBlock &block, int position) const
+{
+   SyntaxBlockData *data = dynamic_cast<SyntaxBlockData *>(block.userData());
+
+   // results are only used for the text and dictionary they were computed from
+   if (! m_isSpellCheck || data == nullptr || data->spellGeneration != m_spellGeneration
+         || data->spellRevision != block.revision()) {
+      return false;
+   }
+
+   for (const auto &range : data->spellRanges) {
+      if (position >= range.first && position <= range.first + range.second) {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+bool Syntax::isBlockDirty(const QTextBlock &block) const
+{
+   SyntaxBlockData *data = dynamic_cast<SyntaxBlockData *>(block.userData());
+
+   return data == nullptr || data->generation != m_generation || data->revision != block.revision();
+}
+
+void Syntax::formatBlock(const QTextBlock &block, bool force)
+{
+   m_formatting = true;
+
+   // only the requested block, blocks reformatted after it because its end state changed are deferred
+   if (force) {
+      m_forceBlockNumber = block.blockNumber();
+   }
+
+   rehighlightBlock(block);
+
+   m_forceBlockNumber = -1;
+   m_formatting = false;
+}
+
+void Syntax::highlightVisible()
+{
+   if (m_inVisible || m_rules == nullptr || m_lastVisible < m_firstVisible) {
+      return;
+   }
+
+   m_inVisible = true;
+
+   QTextBlock block = document()->findBlockByNumber(m_firstVisible);
+   int blockNumber  = m_firstVisible;
+
+   while (block.isValid() && blockNumber <= m_lastVisible) {
+      if (isBlockDirty(block) || needsPaint(block)) {
+         formatBlock(block, false);
+      }
+
+      block = block.next();
+      ++blockNumber;
+   }
+
+   m_inVisible = false;
+
+   startSpell();
+}
+
+void Syntax::highlightSlice()
+{
+   if (m_rules == nullptr) {
+      return;
+   }
+
+   QElapsedTimer timer;
+   timer.start();
+
+   if (m_result != nullptr) {
+      applyResult(timer);
+
+      // spell check follows the highlighter through the document
+      startSpell();
+
+      // more to apply or a new job to start
+      m_sliceTimer.start(0);
+      return;
+   }
+
+   if (m_job != nullptr) {
+      // worker is busy, the result will restart the timer
+      return;
+   }
+
+   // blocks which are already current do not need to be sent to the worker
+   QTextBlock block = document()->findBlockByNumber(m_nextBlock);
+
+   while (block.isValid() && ! isBlockDirty(block)) {
+
+      if (needsPaint(block)) {
+         // colors changed, apply the cached runs with the new palette
+         formatBlock(block, true);
+      }
+
+      block = block.next();
+      ++m_nextBlock;
+
+      if (timer.elapsed() >= SLICE_BUDGET) {
+         m_sliceTimer.start(0);
+         return;
+      }
+   }
+
+   if (block.isValid()) {
+      startJob(block);
+   }
+}
+
+void Syntax::startJob(QTextBlock block)
+{
+   QSharedPointer<SyntaxJob> job(new SyntaxJob);
+
+   job->id            = ++m_jobId;
+   job->generation    = m_generation;
+   job->editCount     = m_editCount;
+   job->firstBlock    = block.blockNumber();
+   job->previousState = block.previous().isValid() ? block.previous().userState() : -1;
+
+   // snapshot of the block text, QString is implicitly shared so this is cheap
+   while (block.isValid() && job->texts.size() < JOB_BLOCKS) {
+      job->texts.append(block.text());
+      job->revisions.append(block.revision());
+
+      block = block.next();
+   }
+
+   m_job = job;
+   m_pool.start(new SyntaxTask(this, m_rules, job, &m_jobId));
+}
+
+void Syntax::cancelJob()
+{
+   // a running task checks the id after each block and stops
+   ++m_jobId;
+
+   m_job.reset();
+   m_result.reset();
+}
+
+void Syntax::applyResult(const QElapsedTimer &timer)
+{
+   const SyntaxJob &job = *m_result;
+
+   QTextBlock block = document()->findBlockByNumber(job.firstBlock + m_resultIndex);
+
+   while (block.isValid() && m_resultIndex < job.texts.size()) {
+      int index = m_resultIndex;
+
+      if (block.revision() != job.revisions[index]) {
+         // document changed since the snapshot
+         m_result.reset();
+         return;
+      }
+
+      SyntaxBlockData *data = blockData(block);
+
+      data->generation = job.generation;
+      data->revision   = job.revisions[index];
+      data->startState = (index == 0) ? job.previousState : job.states[index - 1];
+      data->endState   = job.states[index];
+
+      setRuns(block, data, job.runs[index]);
+
+      // only applies the runs, no matching is done on this thread
+      formatBlock(block, true);
+
+      block = block.next();
+      ++m_resultIndex;
+
+      m_nextBlock = job.firstBlock + m_resultIndex;
+
+      if (timer.elapsed() >= SLICE_BUDGET) {
+         return;
+      }
+   }
+
+   m_result.reset();
+}
+
+bool Syntax::isSpellDirty(const QTextBlock &block, int dictRevision) const
+{
+   SyntaxBlockData *data = dynamic_cast<SyntaxBlockData *>(block.userData());
+
+   return data == nullptr || data->spellGeneration != m_spellGeneration || data->spellRevision != block.revision()
+         || data->spellDictionary != dictRevision;
+}
+
+void Syntax::startSpell()
+{
+   SpellCheck *spell = activeSpellCheck();
+
+   if (spell == nullptr || m_spellBatch != nullptr || m_rules == nullptr) {
+      return;
+   }
+
+   const int dictRevision = spell->get_DictRevision();
+
+   QSharedPointer<SpellBatch> batch(new SpellBatch);
+   batch->receiver = this;
+   batch->fileName = m_rules->fileName;
+
+   // source code is only checked in comments and strings
+   const bool allText = m_rules->spellAllText || ! m_settings.spellComments;
+
+   // returns false when the block has not been tokenized yet
+   auto addBlock = [this, &batch, dictRevision, allText] (QTextBlock block) {
+      SpellBlock item;
+      item.blockNumber = block.blockNumber();
+      item.revision    = block.revision();
+      item.text        = block.text();
+
+      if (allText) {
+         if (! item.text.isEmpty()) {
+            item.ranges.append(qMakePair(0, item.text.length()));
+         }
 
       } else {
-         setCurrentBlockState(1);
-         commentLength = text.length() - startIndex;
+         if (isBlockDirty(block)) {
+            return false;
+         }
 
+         for (const auto &run : blockData(block)->runs) {
+            if (run.format == SYN_GROUP_COMMENT || run.format == SYN_GROUP_QUOTE || run.format == SYN_FORMAT_MLCOMMENT) {
+               item.ranges.append(qMakePair(run.start, run.length));
+            }
+         }
       }
 
-      setFormat(startIndex, commentLength, m_multiLineCommentFormat);
-      startIndex = text.indexOf(m_commentStartExpression, startIndex + commentLength);
+      if (item.ranges.isEmpty()) {
+         // nothing to check
+         SyntaxBlockData *data = blockData(block);
+
+         data->spellGeneration = m_spellGeneration;
+         data->spellRevision   = item.revision;
+         data->spellDictionary = dictRevision;
+         data->spellRanges.clear();
+
+         return true;
+      }
+
+      batch->blocks.append(item);
+
+      return true;
+   };
+
+   // visible blocks first
+   QTextBlock block = document()->findBlockByNumber(m_firstVisible);
+   int blockNumber  = m_firstVisible;
+
+   while (block.isValid() && blockNumber <= m_lastVisible) {
+      if (isSpellDirty(block, dictRevision)) {
+         addBlock(block);
+      }
+
+      block = block.next();
+      ++blockNumber;
    }
 
-   // spell check
-   if (m_spellCheck && m_isSpellCheck)  {
-      QTextBoundaryFinder wordFinder(QTextBoundaryFinder::Word, text);
+   if (batch->blocks.isEmpty()) {
+      // remainder of the document, stops at the first block the highlighter has not reached
+      block = document()->findBlockByNumber(m_nextSpellBlock);
+
+      while (block.isValid() && batch->blocks.size() < SPELL_BLOCKS) {
+         if (isSpellDirty(block, dictRevision) && ! addBlock(block)) {
+            break;
+         }
+
+         block = block.next();
+         ++m_nextSpellBlock;
+      }
+   }
+
+   if (batch->blocks.isEmpty()) {
+      return;
+   }
+
+   m_spellBatch = batch;
+   spell->spellBatch(batch);
+}
+
+void Syntax::cancelSpell()
+{
+   if (m_spellBatch != nullptr) {
+      SpellCheck::cancelBatch(m_spellBatch);
+      m_spellBatch.reset();
+   }
+}
+
+void Syntax::applySpell(const SpellBatch &batch)
+{
+   for (const auto &item : batch.blocks) {
+      QTextBlock block = document()->findBlockByNumber(item.blockNumber);
+
+      if (! block.isValid() || block.revision() != item.revision) {
+         continue;
+      }
+
+      SyntaxBlockData *data = blockData(block);
+
+      // blocks without misspelled words before or after do not need to be painted
+      bool repaint = data->spellPainted || ! item.misspelled.isEmpty();
+
+      data->spellGeneration = m_spellGeneration;
+      data->spellRevision   = item.revision;
+      data->spellDictionary = batch.dictRevision;
+      data->spellRanges     = item.misspelled;
+
+      if (repaint && ! isBlockDirty(block)) {
+         formatBlock(block, true);
+      }
+   }
+}
+
+void Syntax::setRuns(const QTextBlock &block, SyntaxBlockData *data, const QVector<SyntaxRun> &runs)
+{
+   if (! m_settings.spellComments || data->runs == runs) {
+      data->runs = runs;
+      return;
+   }
+
+   // a comment or string may have moved, the block is spell checked again
+   data->runs = runs;
+   data->spellRevision = -1;
+
+   m_nextSpellBlock = qMin(m_nextSpellBlock, block.blockNumber());
+}
+
+void Syntax::underlineWord(int start, int length)
+{
+   // keep the syntax colors of the word and add the underline
+   const int end = start + length;
+
+   while (start < end) {
+      QTextCharFormat current = format(start);
+      int next = start + 1;
+
+      while (next < end && format(next) == current) {
+         ++next;
+      }
+
+      current.merge(m_formats[SYN_FORMAT_SPELL]);
+      setFormat(start, next - start, current);
+
+      start = next;
+   }
+}
+
+bool Syntax::event(QEvent *event)
+{
+   if (event->type() == SpellResultEvent::eventType()) {
+      QSharedPointer<SpellBatch> batch = static_cast<SpellResultEvent *>(event)->m_batch;
+
+      if (batch == m_spellBatch) {
+         m_spellBatch.reset();
+
+         applySpell(*batch);
+         startSpell();
+      }
+
+      return true;
+   }
+
+   if (event->type() != SYNTAX_RESULT_EVENT) {
+      return QSyntaxHighlighter::event(event);
+   }
 
-      while (wordFinder.position() < text.length()) {
-         int wordStart  = wordFinder.position();
-         int wordLength = wordFinder.toNextBoundary() - wordStart;
+   QSharedPointer<SyntaxJob> job = static_cast<SyntaxResultEvent *>(event)->m_job;
 
-         QStringView word = text.midView(wordStart, wordLength).trimmed();
+   if (job == m_job) {
+      m_job.reset();
 
-         if ( ! m_spellCheck->spell(word) )   {
-            setFormat(wordStart, wordLength, m_spellCheckFormat);
+      if (job->generation == m_generation && job->editCount == m_editCount) {
+         m_result      = job;
+         m_resultIndex = 0;
+      }
+
+      m_sliceTimer.start(0);
+   }
+
+   return true;
+}
+
+void Syntax::documentChanged(int position, int charsRemoved, int charsAdded)
+{
+   (void) charsRemoved;
+   (void) charsAdded;
+
+   if (m_formatting) {
+      // rehighlightBlock() reports format changes through contentsChange
+      return;
+   }
+
+   // results from the worker no longer match the document
+   ++m_editCount;
+   cancelJob();
+   cancelSpell();
+
+   m_nextSpellBlock = qMin(m_nextSpellBlock, document()->findBlock(position).blockNumber());
+
+   int blockCount = document()->blockCount();
+
+   if (blockCount < m_blockCount) {
+      // removed blocks shift deferred blocks up, resume from the edit
+      m_nextBlock = qMin(m_nextBlock, document()->findBlock(position).blockNumber());
+   }
+
+   m_blockCount = blockCount;
+
+   if (m_nextBlock < blockCount) {
+      // pending work waits until the user stops typing
+      m_sliceTimer.start(IDLE_DELAY);
+   }
+}
+
+void Syntax::highlightBlock(const QString &text)
+{
+   if (m_rules == nullptr) {
+      return;
+   }
+
+   QTextBlock block = currentBlock();
+   SyntaxBlockData *data = blockData(block);
+
+   int previousState = previousBlockState();
+
+   bool isCurrent = data->generation == m_generation && data->revision == block.revision() &&
+         data->startState == previousState;
+
+   bool isDeferred = false;
+
+   if (! isCurrent) {
+      int blockNumber = block.blockNumber();
+
+      if (blockNumber != m_forceBlockNumber && (blockNumber < m_firstVisible || blockNumber > m_lastVisible)) {
+         // off screen, defer to the background pass, the previous runs are applied again below
+         // since QSyntaxHighlighter clears the formats of the block
+         data->generation = 0;
+         m_nextBlock = qMin(m_nextBlock, blockNumber);
+
+         if (! m_sliceTimer.isActive()) {
+            m_sliceTimer.start(0);
          }
+
+         isDeferred = true;
+
+      } else {
+         // visible block, tokenize now so typing is not delayed
+         data->generation = m_generation;
+         data->revision   = block.revision();
+         data->startState = previousState;
+
+         QVector<SyntaxRun> runs;
+         data->endState   = tokenize(*m_rules, text, previousState, runs);
+
+         setRuns(block, data, runs);
+
+         QTextBlock previous = block.previous();
+
+         if (previous.isValid() && isBlockDirty(previous)) {
+            // previous state is not known yet, the background pass formats this block again
+            data->generation = 0;
+            m_nextBlock = qMin(m_nextBlock, blockNumber);
+
+            if (! m_sliceTimer.isActive()) {
+               m_sliceTimer.start(0);
+            }
+         }
+      }
+   }
+
+   for (const auto &run : data->runs) {
+      setFormat(run.start, run.length, m_formats[run.format]);
+   }
+
+   // spell check results are only valid for the text they were computed from
+   data->spellPainted = false;
+
+   if (m_isSpellCheck && data->spellGeneration == m_spellGeneration && data->spellRevision == block.revision()) {
+      for (const auto &range : data->spellRanges) {
+         underlineWord(range.first, range.second);
       }
+
+      data->spellPainted = ! data->spellRanges.isEmpty();
+   }
+
+   data->palette = m_palette;
+
+   if (isDeferred) {
+      // leave the block state unchanged so the following blocks are not formatted again
+      return;
    }
+
+   setCurrentBlockState(data->endState);
 }
 
+int Syntax::tokenize(const SyntaxRules &rules, const QString &text, int previousState,
+      QVector<SyntaxRun> &runs)
+{
+   // must not touch the document or any Syntax member, called from the worker thread
+   runs.clear();
+
+   const int length = text.length();
+
+   // format id of each character, each range is emitted as one run at the end
+   QVector<qint8> formatMap(length, -1);
+
+   auto paint = [&formatMap] (int start, int count, int format) {
+      std::fill(formatMap.begin() + start, formatMap.begin() + start + count, qint8(format));
+   };
+
+   // per rule statistics, only collected while the profiler is enabled
+   const bool profile = SyntaxProfiler::isEnabled();
+
+   QVector<SyntaxProfileSample> samples;
+   QElapsedTimer clock;
+
+   auto addSample = [&samples, profile] (int format, const QString &rule) {
+      if (! profile) {
+         return -1;
+      }
+
+      samples.append(SyntaxProfileSample{format, rule, 0, 0, 0, 0});
+
+      return samples.size() - 1;
+   };
+
+   // one pass over the text lets most rules be skipped without running the regex engine
+   quint64 blockChars[2] = {0, 0};
+
+   for (QChar c : text) {
+      markChar(blockChars, c);
+   }
+
+   QRegularExpressionMatch match;
+   int state = 0;
+
+   const int mlSample = addSample(SYN_FORMAT_MLCOMMENT, rules.commentStart.regExp.pattern());
+
+   auto closeComment = [&rules, &text, &match, &state, &samples, &clock, mlSample, length] (int from) {
+      if (mlSample != -1) {
+         clock.start();
+      }
+
+      match = rules.commentEnd.regExp.match(text, text.begin() + from);
+
+      if (mlSample != -1) {
+         samples[mlSample].nsecs += clock.nsecsElapsed();
+         ++samples[mlSample].invocations;
+      }
+
+      if (match.hasMatch()) {
+         return int(match.capturedEnd(0) - text.begin());
+      }
+
+      // comment continues in the next block
+      state = 1;
+
+      return length;
+   };
+
+   // pass one, comments and strings from left to right, the region which starts first wins
+   struct Region
+   {
+      const SyntaxPattern *pattern;
+      int format;
+      int start;
+      int end;
+      int sample;
+   };
+
+   QVector<Region> regions;
+   regions.append(Region{&rules.commentStart, SYN_FORMAT_MLCOMMENT, -2, -2, mlSample});
+
+   for (const auto &pattern : rules.groupPatterns[SYN_GROUP_COMMENT]) {
+      regions.append(Region{&pattern, SYN_GROUP_COMMENT, -2, -2, addSample(SYN_GROUP_COMMENT, pattern.regExp.pattern())});
+   }
+
+   for (const auto &pattern : rules.groupPatterns[SYN_GROUP_QUOTE]) {
+      regions.append(Region{&pattern, SYN_GROUP_QUOTE, -2, -2, addSample(SYN_GROUP_QUOTE, pattern.regExp.pattern())});
+   }
+
+   for (auto &item : regions) {
+      if (! canMatch(*item.pattern, text, blockChars)) {
+         item.start = -1;
+
+         if (item.sample != -1) {
+            ++samples[item.sample].skipped;
+         }
+      }
+   }
+
+   // ranges of the text outside of comments and strings
+   QVector<QPair<int, int>> gaps;
+
+   int pos = 0;
+
+   if (previousState == 1) {
+      pos = closeComment(0);
+      paint(0, pos, SYN_FORMAT_MLCOMMENT);
+   }
+
+   while (pos < length) {
+      Region *next = nullptr;
+
+      for (auto &item : regions) {
+
+         if (item.start != -1 && item.start < pos) {
+            // previous match was consumed, search again from the current position
+            if (item.sample != -1) {
+               clock.start();
+            }
+
+            match = item.pattern->regExp.match(text, text.begin() + pos);
+
+            // an empty match is skipped, the region may still match a real range later in the block
+            while (match.hasMatch() && match.capturedLength() == 0 && match.capturedEnd(0) != text.end()) {
+               match = item.pattern->regExp.match(text, match.capturedEnd(0) + 1);
+            }
+
+            if (item.sample != -1) {
+               samples[item.sample].nsecs += clock.nsecsElapsed();
+               ++samples[item.sample].invocations;
+            }
+
+            if (match.hasMatch() && match.capturedLength() > 0) {
+               item.start = match.capturedStart(0) - text.begin();
+               item.end   = match.capturedEnd(0) - text.begin();
+
+            } else {
+               item.start = -1;
+            }
+         }
+
+         if (item.start >= 0 && (next == nullptr || item.start < next->start)) {
+            next = &item;
+         }
+      }
+
+      if (next == nullptr) {
+         gaps.append(qMakePair(pos, length));
+         break;
+      }
+
+      if (next->start > pos) {
+         gaps.append(qMakePair(pos, next->start));
+      }
+
+      int regionEnd = next->end;
+
+      if (next->format == SYN_FORMAT_MLCOMMENT) {
+         regionEnd = closeComment(next->end);
+      }
+
+      if (next->sample != -1) {
+         ++samples[next->sample].matches;
+      }
+
+      paint(next->start, regionEnd - next->start, next->format);
+      pos = regionEnd;
+   }
+
+   // pass two, keywords only in the gaps
+   QVector<WordMatch> wordMatches;
+
+   if (! rules.wordList.isEmpty() && ! gaps.isEmpty()) {
+      // all plain keywords share one hashed scan, reported as the word list
+      const int wordSample = addSample(SYN_FORMAT_COUNT, "identifier scan");
+
+      if (wordSample != -1) {
+         clock.start();
+      }
+
+      int index = 0;
+
+      auto iter = text.cbegin();
+      auto end  = text.cend();
+
+      while (iter != end) {
+
+         if (! isWordChar(*iter) || formatMap[index] != -1) {
+            ++iter;
+            ++index;
+            continue;
+         }
+
+         auto wordStart = iter;
+         int startIndex = index;
+
+         while (iter != end && isWordChar(*iter) && formatMap[index] == -1) {
+            ++iter;
+            ++index;
+         }
+
+         QString word(wordStart, iter);
+
+         if (rules.ignoreCase) {
+            word = word.toCaseFolded();
+         }
+
+         auto item = rules.wordList.constFind(word);
+
+         if (item != rules.wordList.constEnd()) {
+            wordMatches.append(WordMatch{startIndex, index - startIndex, item.value()});
+         }
+      }
+
+      if (wordSample != -1) {
+         samples[wordSample].nsecs      += clock.nsecsElapsed();
+         samples[wordSample].invocations = 1;
+         samples[wordSample].matches     = wordMatches.size();
+      }
+   }
+
+   for (int group = 0; group < SYN_GROUP_QUOTE && ! gaps.isEmpty(); ++group) {
+      const uint groupBit = 1u << group;
+
+      for (const auto &item : wordMatches) {
+         if (item.groups & groupBit) {
+            paint(item.start, item.length, group);
+         }
+      }
+
+      for (const auto &item : rules.groupPatterns[group]) {
+         const int sample = addSample(group, item.regExp.pattern());
+
+         if (! canMatch(item, text, blockChars)) {
+            if (sample != -1) {
+               ++samples[sample].skipped;
+            }
+
+            continue;
+         }
+
+         if (sample != -1) {
+            clock.start();
+         }
+
+         const QRegularExpression &pattern = item.regExp;
+
+         int gap = 0;
+         match   = pattern.match(text, text.begin() + gaps[0].first);
+
+         int invocations = 1;
+         int matches     = 0;
+
+         while (match.hasMatch()) {
+            int index = match.capturedStart(0) - text.begin();
+            int end   = match.capturedEnd(0) - text.begin();
+
+            while (gap < gaps.size() && gaps[gap].second <= index) {
+               ++gap;
+            }
+
+            if (gap == gaps.size()) {
+               break;
+            }
+
+            if (index < gaps[gap].first) {
+               // started inside a comment or string, resume after it
+               match = pattern.match(text, text.begin() + gaps[gap].first);
+               ++invocations;
+
+               continue;
+            }
+
+            paint(index, qMin(end, gaps[gap].second) - index, group);
+            ++matches;
+
+            // get new match
+            match = pattern.match(text, match.capturedEnd(0));
+            ++invocations;
+         }
+
+         if (sample != -1) {
+            samples[sample].nsecs      += clock.nsecsElapsed();
+            samples[sample].invocations = invocations;
+            samples[sample].matches     = matches;
+         }
+      }
+   }
+
+   // one run per range with the same format
+   int index = 0;
+
+   while (index < length) {
+      int start  = index;
+      int format = formatMap[index];
+
+      while (index < length && formatMap[index] == format) {
+         ++index;
+      }
+
+      if (format != -1) {
+         runs.append(SyntaxRun{start, index - start, format});
+      }
+   }
+
+   if (profile) {
+      SyntaxProfiler::record(rules.fileName, samples);
+   }
+
+   return state;
+}
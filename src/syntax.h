@@ -19,12 +19,65 @@
 
 #include "settings.h"
 #include "spellcheck.h"
+#include "syntax_registry.h"
 
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QJsonArray>
 #include <QRegularExpression>
+#include <QSharedPointer>
 #include <QSyntaxHighlighter>
+#include <QTextBlock>
 #include <QTextCharFormat>
+#include <QThreadPool>
+#include <QTimer>
 #include <QVector>
 
+#include <atomic>
+
+struct SyntaxJob;
+
+// format ids used in SyntaxRun, the rule groups come first
+enum SyntaxFormat {
+   SYN_FORMAT_MLCOMMENT = SYN_GROUP_COUNT, SYN_FORMAT_SPELL, SYN_FORMAT_COUNT
+};
+
+struct SyntaxRun
+{
+   int start;
+   int length;
+   int format;
+
+   bool operator==(const SyntaxRun &other) const {
+      return start == other.start && length == other.length && format == other.format;
+   }
+};
+
+class SyntaxBlockData : public QTextBlockUserData
+{
+   public:
+      // highlight pass which last formatted this block, 0 when the block was deferred
+      int generation = 0;
+
+      // block revision and previous block state the runs were computed from
+      int revision   = -1;
+      int startState = -1;
+      int endState   = -1;
+
+      // palette used when the runs were last applied
+      int palette    = 0;
+
+      QVector<SyntaxRun> runs;
+
+      // misspelled words from the spell check worker as (start, length)
+      int spellGeneration = 0;
+      int spellRevision   = -1;
+      int spellDictionary = -1;
+      bool spellPainted   = false;
+
+      QVector<QPair<int, int>> spellRanges;
+};
+
 class Syntax : public QSyntaxHighlighter
 {
    CS_OBJECT(Syntax)
@@ -32,21 +85,72 @@ class Syntax : public QSyntaxHighlighter
    public:
       Syntax(QTextDocument *document, QString synFName,
             const struct Settings &settings, SpellCheck *spell = nullptr);
+      ~Syntax();
 
       bool processSyntax();
       bool processSyntax(const struct Settings &settings);
       void set_Spell(bool value);
+      void set_SpellComments(bool value);
+      void set_VisibleBlocks(int first, int last);
+
+      // visible blocks are highlighted immediately, the remainder in the background
+      void rehighlightDocument();
+
+      // applies the current formats to the cached runs, no matching is done
+      void repaintDocument();
+
+      // true when position in the block is inside a word underlined by the spell check
+      bool isMisspelled(const QTextBlock &block, int position) const;
+
+      static QSharedPointer<const SyntaxRules> compileRules(const QString &fileName);
+      static SyntaxPattern compilePattern(const QString &pattern, bool ignoreCase);
+
+      // matches one block of text, thread safe since it only reads the shared rules
+      static int tokenize(const SyntaxRules &rules, const QString &text, int previousState,
+            QVector<SyntaxRun> &runs);
 
    protected:
+      bool event(QEvent *event) override;
       void highlightBlock(const QString &text) override;
 
    private:
-      struct HighlightingRule
+      struct WordMatch
       {
-         QRegularExpression pattern;
-         QTextCharFormat format;
+         int start;
+         int length;
+         uint groups;
       };
 
+      CS_SLOT_1(Private, void highlightSlice())
+      CS_SLOT_2(highlightSlice)
+
+      CS_SLOT_1(Private, void documentChanged(int position, int charsRemoved, int charsAdded))
+      CS_SLOT_2(documentChanged)
+
+      SpellCheck *activeSpellCheck() const;
+      static SyntaxBlockData *blockData(QTextBlock &block);
+      bool isBlockDirty(const QTextBlock &block) const;
+      bool needsPaint(const QTextBlock &block) const;
+      void setFormats();
+
+      void formatBlock(const QTextBlock &block, bool force);
+      void highlightVisible();
+
+      void startJob(QTextBlock block);
+      void cancelJob();
+      void applyResult(const QElapsedTimer &timer);
+
+      bool isSpellDirty(const QTextBlock &block, int dictRevision) const;
+      void resetSpell();
+      void setRuns(const QTextBlock &block, SyntaxBlockData *data, const QVector<SyntaxRun> &runs);
+      void startSpell();
+      void cancelSpell();
+      void applySpell(const SpellBatch &batch);
+      void underlineWord(int start, int length);
+
+      static void addRuleGroup(SyntaxRules *rules, SyntaxGroup group, const QJsonArray &list);
+      static bool isPlainWord(const QString &pattern, QString &word);
+      static QStringList requiredLiterals(const QString &pattern);
       static QByteArray json_ReadFile(QString fileName);
 
       QString m_syntaxFile;
@@ -55,13 +159,39 @@ class Syntax : public QSyntaxHighlighter
       SpellCheck *m_spellCheck;
       bool m_isSpellCheck;
 
-      QRegularExpression m_commentStartExpression;
-      QRegularExpression m_commentEndExpression;
+      // shared with every other Syntax using the same file
+      QSharedPointer<const SyntaxRules> m_rules;
+
+      // palette indexed by SyntaxFormat
+      QVector<QTextCharFormat> m_formats;
+      int m_palette;
+
+      // background highlighting
+      QTimer m_sliceTimer;
+      int m_generation;
+      int m_nextBlock;
+      int m_blockCount;
+      int m_firstVisible;
+      int m_lastVisible;
+
+      // block formatted by formatBlock() even when off screen, -1 for none
+      int m_forceBlockNumber;
+      bool m_formatting;
+      bool m_inVisible;
+
+      // tokenizing on the worker thread
+      QThreadPool m_pool;
+      std::atomic<int> m_jobId;
+      int m_editCount;
 
-      QTextCharFormat m_multiLineCommentFormat;
-      QTextCharFormat m_spellCheckFormat;
+      QSharedPointer<SyntaxJob> m_job;
+      QSharedPointer<SyntaxJob> m_result;
+      int m_resultIndex;
 
-      QVector<HighlightingRule> highlightingRules;
+      // spell check on the SpellCheck worker, applied as an underline over the syntax formats
+      QSharedPointer<SpellBatch> m_spellBatch;
+      int m_spellGeneration;
+      int m_nextSpellBlock;
 };
 
 #endif
@@ -0,0 +1,155 @@
+/**************************************************************************
+*
+* Copyright (c) 2012-2025 Barbara Geller
+*
+* Diamond Editor is free software. You can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Diamond Editor is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* https://www.gnu.org/licenses/
+*
+***************************************************************************/
+
+
+#include "syntax.h"
+#include "syntax_profiler.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+
+std::atomic<bool> SyntaxProfiler::m_enabled(false);
+
+QMutex SyntaxProfiler::m_mutex;
+QHash<QString, SyntaxProfileEntry> SyntaxProfiler::m_entries;
+
+void SyntaxProfiler::setEnabled(bool value)
+{
+   m_enabled.store(value);
+}
+
+void SyntaxProfiler::record(const QString &fileName, const QVector<SyntaxProfileSample> &samples)
+{
+   QMutexLocker lock(&m_mutex);
+
+   for (const auto &sample : samples) {
+      QString key = fileName + '\n' + QString::number(sample.format) + '\n' + sample.rule;
+
+      SyntaxProfileEntry &entry = m_entries[key];
+
+      if (entry.fileName.isEmpty()) {
+         entry.fileName = fileName;
+         entry.format   = sample.format;
+         entry.rule     = sample.rule;
+      }
+
+      entry.invocations += sample.invocations;
+      entry.skipped     += sample.skipped;
+      entry.matches     += sample.matches;
+      entry.nsecs       += sample.nsecs;
+   }
+}
+
+void SyntaxProfiler::clear()
+{
+   QMutexLocker lock(&m_mutex);
+   m_entries.clear();
+}
+
+QVector<SyntaxProfileEntry> SyntaxProfiler::entries()
+{
+   QVector<SyntaxProfileEntry> retval;
+
+   {
+      QMutexLocker lock(&m_mutex);
+
+      for (const auto &entry : m_entries) {
+         retval.append(entry);
+      }
+   }
+
+   std::sort(retval.begin(), retval.end(),
+         [] (const SyntaxProfileEntry &a, const SyntaxProfileEntry &b) { return a.nsecs > b.nsecs; } );
+
+   return retval;
+}
+
+QString SyntaxProfiler::formatName(int format)
+{
+   switch (format) {
+      case SYN_GROUP_KEY:
+         return "keyword";
+
+      case SYN_GROUP_CLASS:
+         return "class";
+
+      case SYN_GROUP_FUNC:
+         return "function";
+
+      case SYN_GROUP_TYPE:
+         return "type";
+
+      case SYN_GROUP_QUOTE:
+         return "quote";
+
+      case SYN_GROUP_COMMENT:
+         return "comment";
+
+      case SYN_FORMAT_MLCOMMENT:
+         return "multi-line comment";
+
+      case SYN_FORMAT_SPELL:
+         return "spell check";
+
+      case SYN_FORMAT_COUNT:
+         return "word list";
+
+      default:
+         return QString();
+   }
+}
+
+QByteArray SyntaxProfiler::toJson()
+{
+   QJsonArray list;
+
+   for (const auto &entry : entries()) {
+      QJsonObject object;
+
+      object.insert("file",        entry.fileName);
+      object.insert("group",       formatName(entry.format));
+      object.insert("rule",        entry.rule);
+      object.insert("invocations", double(entry.invocations));
+      object.insert("skipped",     double(entry.skipped));
+      object.insert("matches",     double(entry.matches));
+      object.insert("nsecs",       double(entry.nsecs));
+
+      list.append(object);
+   }
+
+   QJsonObject object;
+   object.insert("rules", list);
+
+   return QJsonDocument(object).toJson();
+}
+
+bool SyntaxProfiler::writeJson(const QString &fileName)
+{
+   QFile file(fileName);
+
+   if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+      return false;
+   }
+
+   file.write(toJson());
+   file.close();
+
+   return true;
+}
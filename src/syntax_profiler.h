@@ -0,0 +1,81 @@
+/**************************************************************************
+*
+* Copyright (c) 2012-2025 Barbara Geller
+*
+* Diamond Editor is free software. You can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Diamond Editor is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* https://www.gnu.org/licenses/
+*
+***************************************************************************/
+
+
+#ifndef SYNTAX_PROFILER_H
+#define SYNTAX_PROFILER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+
+// statistics for one rule, collected by Syntax::tokenize()
+struct SyntaxProfileSample
+{
+   int format;
+   QString rule;
+
+   qint64 invocations;
+   qint64 skipped;
+   qint64 matches;
+   qint64 nsecs;
+};
+
+struct SyntaxProfileEntry
+{
+   QString fileName;
+   int format;
+   QString rule;
+
+   qint64 invocations = 0;
+   qint64 skipped     = 0;
+   qint64 matches     = 0;
+   qint64 nsecs       = 0;
+};
+
+class SyntaxProfiler
+{
+   public:
+      static bool isEnabled() {
+         return m_enabled.load(std::memory_order_relaxed);
+      }
+
+      static void setEnabled(bool value);
+
+      // called once per block and once per spell batch, from a worker or the GUI thread
+      static void record(const QString &fileName, const QVector<SyntaxProfileSample> &samples);
+
+      static void clear();
+
+      // sorted by total time, slowest first
+      static QVector<SyntaxProfileEntry> entries();
+
+      static QString formatName(int format);
+      static QByteArray toJson();
+      static bool writeJson(const QString &fileName);
+
+   private:
+      static std::atomic<bool> m_enabled;
+
+      static QMutex m_mutex;
+      static QHash<QString, SyntaxProfileEntry> m_entries;
+};
+
+#endif
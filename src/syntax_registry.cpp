@@ -0,0 +1,191 @@
+/**************************************************************************
+*
+* Copyright (c) 2012-2025 Barbara Geller
+*
+* Diamond Editor is free software. You can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Diamond Editor is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* https://www.gnu.org/licenses/
+*
+***************************************************************************/
+
+#include "syntax.h"
+#include "syntax_registry.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+
+// bump when the layout of the cache file changes
+static constexpr const quint32 CACHE_MAGIC   = 0x44534E43;
+static constexpr const quint32 CACHE_VERSION = 3;
+
+QHash<QString, SyntaxRegistry::Entry> SyntaxRegistry::m_registry;
+
+QSharedPointer<const SyntaxRules> SyntaxRegistry::getRules(const QString &fileName)
+{
+   QFileInfo fileInfo(fileName);
+
+   auto iter = m_registry.find(fileName);
+
+   if (iter != m_registry.end()) {
+      if (iter->lastModified == fileInfo.lastModified() && iter->fileSize == fileInfo.size()) {
+         return iter->rules;
+      }
+
+      // syntax file was modified
+      m_registry.erase(iter);
+   }
+
+   QSharedPointer<const SyntaxRules> rules = readCache(fileName, fileInfo);
+
+   if (rules == nullptr) {
+      // cache is missing or stale, fall back to the json file
+      rules = Syntax::compileRules(fileName);
+
+      if (rules != nullptr) {
+         writeCache(fileName, fileInfo, *rules);
+      }
+   }
+
+   if (rules != nullptr) {
+      Entry entry;
+
+      entry.lastModified = fileInfo.lastModified();
+      entry.fileSize     = fileInfo.size();
+      entry.rules        = rules;
+
+      m_registry.insert(fileName, entry);
+   }
+
+   return rules;
+}
+
+QString SyntaxRegistry::cacheFileName(const QString &fileName)
+{
+   // syn_cpp.json is cached in syn_cpp.json.cache
+   return fileName + ".cache";
+}
+
+QSharedPointer<const SyntaxRules> SyntaxRegistry::readCache(const QString &fileName, const QFileInfo &fileInfo)
+{
+   QFile file(cacheFileName(fileName));
+
+   if (! file.open(QIODevice::ReadOnly)) {
+      return QSharedPointer<const SyntaxRules>();
+   }
+
+   QByteArray data = file.readAll();
+   file.close();
+
+   QDataStream stream(&data, QIODevice::ReadOnly);
+
+   quint32 magic;
+   quint32 version;
+
+   QString sourcePath;
+   qint64 sourceSize;
+   qint64 sourceModified;
+
+   stream >> magic >> version;
+
+   if (magic != CACHE_MAGIC || version != CACHE_VERSION) {
+      return QSharedPointer<const SyntaxRules>();
+   }
+
+   stream >> sourcePath >> sourceSize >> sourceModified;
+
+   if (sourcePath != fileInfo.absoluteFilePath() || sourceSize != fileInfo.size() ||
+         sourceModified != fileInfo.lastModified().toMSecsSinceEpoch()) {
+      return QSharedPointer<const SyntaxRules>();
+   }
+
+   QSharedPointer<SyntaxRules> rules(new SyntaxRules);
+   rules->fileName = fileName;
+   rules->groupPatterns.resize(SYN_GROUP_COUNT);
+
+   stream >> rules->ignoreCase >> rules->spellAllText;
+
+   for (int group = 0; group < SYN_GROUP_COUNT; ++group) {
+      qint32 count;
+      stream >> count;
+
+      for (int k = 0; k < count; ++k) {
+         QString pattern;
+         bool ignoreCase;
+
+         stream >> pattern >> ignoreCase;
+
+         rules->groupPatterns[group].append(Syntax::compilePattern(pattern, ignoreCase));
+      }
+   }
+
+   qint32 wordCount;
+   stream >> wordCount;
+
+   rules->wordList.reserve(wordCount);
+
+   for (int k = 0; k < wordCount; ++k) {
+      QString word;
+      quint32 groups;
+
+      stream >> word >> groups;
+      rules->wordList.insert(word, groups);
+   }
+
+   QString commentStart;
+   QString commentEnd;
+
+   stream >> commentStart >> commentEnd;
+
+   if (stream.status() != QDataStream::Ok) {
+      // truncated or corrupt
+      return QSharedPointer<const SyntaxRules>();
+   }
+
+   rules->commentStart = Syntax::compilePattern(commentStart, false);
+   rules->commentEnd   = Syntax::compilePattern(commentEnd, false);
+
+   return rules;
+}
+
+void SyntaxRegistry::writeCache(const QString &fileName, const QFileInfo &fileInfo, const SyntaxRules &rules)
+{
+   QByteArray data;
+   QDataStream stream(&data, QIODevice::WriteOnly);
+
+   stream << CACHE_MAGIC << CACHE_VERSION;
+   stream << fileInfo.absoluteFilePath() << qint64(fileInfo.size()) << qint64(fileInfo.lastModified().toMSecsSinceEpoch());
+
+   stream << rules.ignoreCase << rules.spellAllText;
+
+   for (const auto &patterns : rules.groupPatterns) {
+      stream << qint32(patterns.size());
+
+      for (const auto &item : patterns) {
+         stream << item.regExp.pattern() << item.ignoreCase;
+      }
+   }
+
+   stream << qint32(rules.wordList.size());
+
+   for (auto iter = rules.wordList.cbegin(); iter != rules.wordList.cend(); ++iter) {
+      stream << iter.key() << quint32(iter.value());
+   }
+
+   stream << rules.commentStart.regExp.pattern() << rules.commentEnd.regExp.pattern();
+
+   // syntax folder may be read only, the cache is an optimization so failures are ignored
+   // replaced in one step, another instance may be reading the old cache
+   QSaveFile file(cacheFileName(fileName));
+
+   if (file.open(QIODevice::WriteOnly)) {
+      file.write(data);
+      file.commit();
+   }
+}
@@ -0,0 +1,83 @@
+/**************************************************************************
+*
+* Copyright (c) 2012-2025 Barbara Geller
+*
+* Diamond Editor is free software. You can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Diamond Editor is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* https://www.gnu.org/licenses/
+*
+***************************************************************************/
+
+#ifndef SYNTAX_REGISTRY_H
+#define SYNTAX_REGISTRY_H
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QHash>
+#include <QRegularExpression>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// rule groups, applied in this order so later groups override earlier ones
+enum SyntaxGroup {
+   SYN_GROUP_KEY, SYN_GROUP_CLASS, SYN_GROUP_FUNC, SYN_GROUP_TYPE,
+   SYN_GROUP_QUOTE, SYN_GROUP_COMMENT, SYN_GROUP_COUNT
+};
+
+// one regular expression rule, every match contains all of the literals
+struct SyntaxPattern
+{
+   QRegularExpression regExp;
+   QStringList literals;
+   bool ignoreCase = false;
+};
+
+// compiled form of one syntax definition, never modified after it is built
+struct SyntaxRules
+{
+   QString fileName;
+   bool ignoreCase = false;
+
+   // plain text definitions, every word is spell checked and not only comments and strings
+   bool spellAllText = false;
+
+   QVector<QVector<SyntaxPattern>> groupPatterns;
+
+   // plain \bword\b patterns, value is a bit mask of the rule groups which contain the word
+   QHash<QString, uint> wordList;
+
+   SyntaxPattern commentStart;
+   SyntaxPattern commentEnd;
+};
+
+class SyntaxRegistry
+{
+   public:
+      // returns the shared rules for a syntax file, loaded from the binary cache when it is current
+      // otherwise compiled from the json file
+      static QSharedPointer<const SyntaxRules> getRules(const QString &fileName);
+
+   private:
+      struct Entry
+      {
+         QDateTime lastModified;
+         qint64 fileSize;
+         QSharedPointer<const SyntaxRules> rules;
+      };
+
+      static QString cacheFileName(const QString &fileName);
+      static QSharedPointer<const SyntaxRules> readCache(const QString &fileName, const QFileInfo &fileInfo);
+      static void writeCache(const QString &fileName, const QFileInfo &fileInfo, const SyntaxRules &rules);
+
+      static QHash<QString, Entry> m_registry;
+};
+
+#endif
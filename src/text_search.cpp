@@ -0,0 +1,240 @@
+/**************************************************************************
+*
+* Copyright (c) 2012-2025 Barbara Geller
+*
+* Diamond Editor is free software. You can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Diamond Editor is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* https://www.gnu.org/licenses/
+*
+***************************************************************************/
+
+#include "text_search.h"
+
+#include <cstring>
+
+// short patterns are found with memchr, longer ones skip ahead with Boyer-Moore-Horspool
+static constexpr const int ANCHOR_LENGTH = 4;
+
+// a text file in a legacy encoding has some invalid UTF-8 but far less than this
+static constexpr const int INVALID_UTF8_PERCENT = 10;
+
+static bool isWordByte(quint8 c)
+{
+   // bytes of multibyte UTF-8 sequences are treated as letters
+   return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+}
+
+TextSearch::TextSearch(const QString &pattern, bool matchCase, bool wholeWords)
+   : m_matchCase(matchCase), m_wholeWords(wholeWords)
+{
+   for (int k = 0; k < 256; ++k) {
+      if (! matchCase && k >= 'A' && k <= 'Z') {
+         m_fold[k] = quint8(k + ('a' - 'A'));
+      } else {
+         m_fold[k] = quint8(k);
+      }
+   }
+
+   m_pattern = pattern.toUtf8();
+
+   for (char &c : m_pattern) {
+      c = char(m_fold[quint8(c)]);
+   }
+
+   const int length = m_pattern.size();
+
+   for (int k = 0; k < 256; ++k) {
+      m_skip[k] = length;
+   }
+
+   for (int k = 0; k < length - 1; ++k) {
+      m_skip[quint8(m_pattern[k])] = length - 1 - k;
+   }
+}
+
+bool TextSearch::canSearchBytes(const QString &pattern, bool matchCase, bool wholeWords, bool regexp)
+{
+   if (regexp || pattern.isEmpty()) {
+      return false;
+   }
+
+   for (QChar c : pattern) {
+      char32_t value = c.unicode();
+
+      if (! matchCase && value >= 0x80) {
+         // case folding outside of ASCII needs the decoded text
+         return false;
+      }
+
+      if (wholeWords && value < 0x80 && std::strchr("\\^$.|?*+()[]{}", char(value)) != nullptr) {
+         // whole word search has always treated the text as a regular expression
+         return false;
+      }
+   }
+
+   return true;
+}
+
+bool TextSearch::isUtf16(const char *data, int size)
+{
+   return size >= 2 && (std::memcmp(data, "\xFF\xFE", 2) == 0 || std::memcmp(data, "\xFE\xFF", 2) == 0);
+}
+
+bool TextSearch::isText(const char *data, int size)
+{
+   if (isUtf16(data, size)) {
+      // every other byte of ASCII text is NUL
+      return true;
+   }
+
+   if (std::memchr(data, '\0', size) != nullptr) {
+      return false;
+   }
+
+   const quint8 *text = reinterpret_cast<const quint8 *>(data);
+
+   int invalid = 0;
+   int k = 0;
+
+   while (k < size) {
+      const quint8 c = text[k];
+      int length;
+
+      if (c < 0x80) {
+         ++k;
+         continue;
+
+      } else if (c >= 0xC2 && c <= 0xDF) {
+         length = 2;
+
+      } else if (c >= 0xE0 && c <= 0xEF) {
+         length = 3;
+
+      } else if (c >= 0xF0 && c <= 0xF4) {
+         length = 4;
+
+      } else {
+         ++invalid;
+         ++k;
+         continue;
+      }
+
+      if (k + length > size) {
+         // sequence cut off at the end of the block
+         break;
+      }
+
+      int j = 1;
+
+      while (j < length && (text[k + j] & 0xC0) == 0x80) {
+         ++j;
+      }
+
+      if (j < length) {
+         ++invalid;
+         ++k;
+
+      } else {
+         k += length;
+      }
+   }
+
+   return invalid * 100 <= size * INVALID_UTF8_PERCENT;
+}
+
+qint64 TextSearch::indexIn(const char *data, qint64 size, qint64 from) const
+{
+   while (from < size) {
+      qint64 pos;
+
+      if (m_matchCase && m_pattern.size() < ANCHOR_LENGTH) {
+         pos = findAnchored(data, size, from);
+      } else {
+         pos = findHorspool(data, size, from);
+      }
+
+      if (pos == -1 || ! m_wholeWords || isWholeWord(data, size, pos)) {
+         return pos;
+      }
+
+      from = pos + 1;
+   }
+
+   return -1;
+}
+
+qint64 TextSearch::findAnchored(const char *data, qint64 size, qint64 from) const
+{
+   const int length = m_pattern.size();
+   const char first = m_pattern[0];
+
+   const char *ptr = data + from;
+   const char *end = data + size - length + 1;
+
+   while (ptr < end) {
+      ptr = static_cast<const char *>(std::memchr(ptr, first, end - ptr));
+
+      if (ptr == nullptr) {
+         break;
+      }
+
+      if (std::memcmp(ptr + 1, m_pattern.constData() + 1, length - 1) == 0) {
+         return ptr - data;
+      }
+
+      ++ptr;
+   }
+
+   return -1;
+}
+
+qint64 TextSearch::findHorspool(const char *data, qint64 size, qint64 from) const
+{
+   const int length = m_pattern.size();
+   const quint8 *pattern = reinterpret_cast<const quint8 *>(m_pattern.constData());
+   const quint8 *text    = reinterpret_cast<const quint8 *>(data);
+
+   const quint8 last = pattern[length - 1];
+
+   qint64 pos = from;
+
+   while (pos + length <= size) {
+      const quint8 c = m_fold[text[pos + length - 1]];
+
+      if (c == last) {
+         int k = length - 2;
+
+         while (k >= 0 && m_fold[text[pos + k]] == pattern[k]) {
+            --k;
+         }
+
+         if (k < 0) {
+            return pos;
+         }
+      }
+
+      pos += m_skip[c];
+   }
+
+   return -1;
+}
+
+bool TextSearch::isWholeWord(const char *data, qint64 size, qint64 pos) const
+{
+   // same rule as \b in a regular expression, word and non word characters on either side
+   const int length = m_pattern.size();
+
+   const bool firstIsWord = isWordByte(quint8(m_pattern[0]));
+   const bool lastIsWord  = isWordByte(quint8(m_pattern[length - 1]));
+
+   const bool beforeIsWord = pos > 0 && isWordByte(quint8(data[pos - 1]));
+   const bool afterIsWord  = pos + length < size && isWordByte(quint8(data[pos + length]));
+
+   return beforeIsWord != firstIsWord && afterIsWord != lastIsWord;
+}
@@ -0,0 +1,61 @@
+/**************************************************************************
+*
+* Copyright (c) 2012-2025 Barbara Geller
+*
+* Diamond Editor is free software. You can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Diamond Editor is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* https://www.gnu.org/licenses/
+*
+***************************************************************************/
+
+#ifndef TEXT_SEARCH_H
+#define TEXT_SEARCH_H
+
+#include <QByteArray>
+#include <QString>
+
+// finds a literal string in UTF-8 text without decoding the text
+class TextSearch
+{
+   public:
+      TextSearch(const QString &pattern, bool matchCase, bool wholeWords);
+
+      // false when the search must be done on decoded text, regular expressions or non ASCII text
+      // compared without case
+      static bool canSearchBytes(const QString &pattern, bool matchCase, bool wholeWords, bool regexp);
+
+      // false for a block containing a NUL byte or mostly invalid UTF-8, checks the start of a file
+      static bool isText(const char *data, int size);
+
+      // true when the data starts with a UTF-16 byte order mark, these files are only searched after decoding
+      static bool isUtf16(const char *data, int size);
+
+      // offset of the first match at or after from, -1 when there is no match
+      qint64 indexIn(const char *data, qint64 size, qint64 from) const;
+
+      int length() const {
+         return m_pattern.size();
+      }
+
+   private:
+      qint64 findAnchored(const char *data, qint64 size, qint64 from) const;
+      qint64 findHorspool(const char *data, qint64 size, qint64 from) const;
+      bool isWholeWord(const char *data, qint64 size, qint64 pos) const;
+
+      // folded to lower case when the search ignores case
+      QByteArray m_pattern;
+
+      bool m_matchCase;
+      bool m_wholeWords;
+
+      quint8 m_fold[256];
+      int m_skip[256];
+};
+
+#endif
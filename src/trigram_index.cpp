@@ -0,0 +1,490 @@
+/**************************************************************************
+*
+* Copyright (c) 2012-2025 Barbara Geller
+*
+* Diamond Editor is free software. You can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Diamond Editor is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* https://www.gnu.org/licenses/
+*
+***************************************************************************/
+
+#include "text_search.h"
+#include "trigram_index.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+static constexpr const quint32 INDEX_MAGIC   = 0x44545249;
+static constexpr const quint32 INDEX_VERSION = 2;
+
+// larger files are not indexed and are always searched
+static constexpr const qint64 INDEX_FILE_LIMIT = 8 * 1024 * 1024;
+
+// only the start of each file is checked for binary data
+static constexpr const int SNIFF_SIZE = 8192;
+
+class TrigramTask : public QRunnable
+{
+   public:
+      TrigramTask(std::function<void ()> func)
+         : m_func(std::move(func))
+      { }
+
+      void run() override {
+         m_func();
+      }
+
+   private:
+      std::function<void ()> m_func;
+};
+
+static inline quint8 foldByte(quint8 c)
+{
+   return (c >= 'A' && c <= 'Z') ? quint8(c + ('a' - 'A')) : c;
+}
+
+// sorted list of the distinct trigrams in the text
+static std::vector<quint32> extractTrigrams(const char *data, qint64 size)
+{
+   std::vector<quint32> retval;
+
+   if (size < 3) {
+      return retval;
+   }
+
+   retval.reserve(size - 2);
+
+   const quint8 *text = reinterpret_cast<const quint8 *>(data);
+   quint32 key = (quint32(foldByte(text[0])) << 8) | foldByte(text[1]);
+
+   for (qint64 k = 2; k < size; ++k) {
+      key = ((key << 8) | foldByte(text[k])) & 0xFFFFFF;
+      retval.push_back(key);
+   }
+
+   std::sort(retval.begin(), retval.end());
+   retval.erase(std::unique(retval.begin(), retval.end()), retval.end());
+
+   return retval;
+}
+
+// file ids in ascending order, each stored as the distance to the previous id in groups of 7 bits
+static QByteArray encodePostings(const QVector<int> &ids)
+{
+   QByteArray retval;
+   retval.reserve(ids.size() * 2);
+
+   int previous = 0;
+
+   for (int id : ids) {
+      quint32 delta = quint32(id - previous);
+      previous = id;
+
+      while (delta >= 0x80) {
+         retval.append(char((delta & 0x7F) | 0x80));
+         delta >>= 7;
+      }
+
+      retval.append(char(delta));
+   }
+
+   return retval;
+}
+
+static bool decodePostings(const QByteArray &bytes, int count, QVector<int> &ids)
+{
+   ids.resize(count);
+
+   const quint8 *data = reinterpret_cast<const quint8 *>(bytes.constData());
+   const int size     = bytes.size();
+
+   int pos      = 0;
+   int previous = 0;
+
+   for (int k = 0; k < count; ++k) {
+      quint32 delta = 0;
+      int shift     = 0;
+
+      while (true) {
+         if (pos == size || shift > 28) {
+            return false;
+         }
+
+         quint8 c = data[pos++];
+         delta |= quint32(c & 0x7F) << shift;
+
+         if ((c & 0x80) == 0) {
+            break;
+         }
+
+         shift += 7;
+      }
+
+      previous += int(delta);
+      ids[k] = previous;
+   }
+
+   return pos == size;
+}
+
+bool TrigramIndexData::candidates(const QByteArray &pattern, QBitArray &retval) const
+{
+   std::vector<quint32> keys = extractTrigrams(pattern.constData(), pattern.size());
+
+   if (keys.empty()) {
+      return false;
+   }
+
+   // intersect the posting lists, shortest first
+   std::vector<const QVector<int> *> lists;
+
+   for (quint32 key : keys) {
+      auto iter = m_postings.constFind(key);
+
+      if (iter == m_postings.constEnd()) {
+         lists.clear();
+         break;
+      }
+
+      lists.push_back(&iter.value());
+   }
+
+   retval = QBitArray(m_files.size());
+
+   if (! lists.empty()) {
+      std::sort(lists.begin(), lists.end(),
+            [] (const QVector<int> *a, const QVector<int> *b) { return a->size() < b->size(); } );
+
+      QVector<int> result = *lists[0];
+
+      for (size_t k = 1; k < lists.size() && ! result.isEmpty(); ++k) {
+         QVector<int> next;
+         std::set_intersection(result.constBegin(), result.constEnd(), lists[k]->constBegin(), lists[k]->constEnd(),
+               std::back_inserter(next));
+
+         result.swap(next);
+      }
+
+      for (int id : result) {
+         retval.setBit(id);
+      }
+   }
+
+   for (int id = 0; id < m_files.size(); ++id) {
+      if (! m_files[id].indexed) {
+         retval.setBit(id);
+      }
+   }
+
+   return true;
+}
+
+TrigramIndex::TrigramIndex(const QString &indexPath)
+   : m_indexPath(indexPath), m_stop(false)
+{
+   m_pool.setMaxThreadCount(1);
+}
+
+TrigramIndex::~TrigramIndex()
+{
+   m_stop = true;
+   m_pool.waitForDone();
+}
+
+QString TrigramIndex::rootPath(const QString &folder)
+{
+   return QDir::cleanPath(QDir::fromNativeSeparators(folder));
+}
+
+QString TrigramIndex::relativePath(const QString &root, const QString &fileName)
+{
+   if (root.endsWith('/')) {
+      return fileName.mid(root.size());
+   }
+
+   return fileName.mid(root.size() + 1);
+}
+
+QString TrigramIndex::indexFileName(const QString &root) const
+{
+   QByteArray hash = QCryptographicHash::hash(root.toUtf8(), QCryptographicHash::Md5).toHex();
+
+   return m_indexPath + "/" + QString::fromLatin1(hash) + ".idx";
+}
+
+QSharedPointer<const TrigramIndexData> TrigramIndex::get_Index(const QString &root)
+{
+   QMutexLocker lock(&m_mutex);
+
+   if (! m_indexes.contains(root)) {
+      // a root which was never indexed is stored as nullptr
+      m_indexes.insert(root, load(root));
+   }
+
+   return m_indexes.value(root);
+}
+
+void TrigramIndex::update(const QString &root, const QStringList &skipFolders)
+{
+   QMutexLocker lock(&m_mutex);
+
+   if (m_updating.contains(root)) {
+      return;
+   }
+
+   m_updating.insert(root);
+   m_pool.start(new TrigramTask([this, root, skipFolders] () { runUpdate(root, skipFolders); } ));
+}
+
+QSharedPointer<TrigramIndexData> TrigramIndex::load(const QString &root) const
+{
+   QFile file(indexFileName(root));
+
+   if (! file.open(QIODevice::ReadOnly)) {
+      return QSharedPointer<TrigramIndexData>();
+   }
+
+   QDataStream in(&file);
+
+   quint32 magic;
+   quint32 version;
+   QString fileRoot;
+
+   in >> magic >> version >> fileRoot;
+
+   if (magic != INDEX_MAGIC || version != INDEX_VERSION || fileRoot != root) {
+      return QSharedPointer<TrigramIndexData>();
+   }
+
+   QSharedPointer<TrigramIndexData> data = QSharedPointer<TrigramIndexData>::create();
+   data->m_root = root;
+
+   qint32 fileCount;
+   in >> fileCount;
+
+   data->m_files.reserve(fileCount);
+
+   for (int k = 0; k < fileCount && in.status() == QDataStream::Ok; ++k) {
+      TrigramFile entry;
+      quint8 indexed;
+
+      in >> entry.path >> entry.size >> entry.modified >> indexed;
+      entry.indexed = indexed != 0;
+
+      data->m_fileIds.insert(entry.path, k);
+      data->m_files.append(entry);
+   }
+
+   qint32 postingCount;
+   in >> postingCount;
+
+   bool isValid = true;
+
+   for (int k = 0; k < postingCount && in.status() == QDataStream::Ok && isValid; ++k) {
+      quint32 key;
+      qint32 count;
+      QByteArray bytes;
+
+      in >> key >> count >> bytes;
+
+      isValid = count >= 0 && decodePostings(bytes, count, data->m_postings[key]);
+   }
+
+   if (in.status() != QDataStream::Ok || ! isValid || data->m_files.size() != fileCount) {
+      // damaged file, build the index again
+      return QSharedPointer<TrigramIndexData>();
+   }
+
+   return data;
+}
+
+void TrigramIndex::save(const TrigramIndexData &data) const
+{
+   QDir().mkpath(m_indexPath);
+
+   QSaveFile file(indexFileName(data.m_root));
+
+   if (! file.open(QIODevice::WriteOnly)) {
+      // index is rebuilt next time, not an error
+      return;
+   }
+
+   QDataStream out(&file);
+
+   out << INDEX_MAGIC << INDEX_VERSION << data.m_root;
+   out << qint32(data.m_files.size());
+
+   for (const TrigramFile &entry : data.m_files) {
+      out << entry.path << entry.size << entry.modified << quint8(entry.indexed ? 1 : 0);
+   }
+
+   out << qint32(data.m_postings.size());
+
+   for (auto iter = data.m_postings.constBegin(); iter != data.m_postings.constEnd(); ++iter) {
+      // one block per trigram rather than one value per file id
+      out << iter.key() << qint32(iter.value().size()) << encodePostings(iter.value());
+   }
+
+   file.commit();
+}
+
+void TrigramIndex::runUpdate(const QString &root, const QStringList &skipFolders)
+{
+   QSharedPointer<const TrigramIndexData> oldData = get_Index(root);
+
+   QSharedPointer<TrigramIndexData> data = QSharedPointer<TrigramIndexData>::create();
+   data->m_root = root;
+
+   // new id of each unchanged file, indexed by the old id
+   QVector<int> keptIds;
+   int keptCount = 0;
+
+   // a file was added, changed or removed since the index was saved
+   bool isChanged = oldData.isNull();
+
+   if (! oldData.isNull()) {
+      keptIds.fill(-1, oldData->fileCount());
+   }
+
+   QStringList dirList;
+   dirList.append(root);
+
+   while (! dirList.isEmpty() && ! m_stop) {
+      QString path = dirList.takeLast();
+
+      QDirIterator fileIter(path, QDir::Files | QDir::NoSymLinks);
+
+      while (fileIter.hasNext() && ! m_stop) {
+         QString name   = fileIter.next();
+         QFileInfo info = fileIter.fileInfo();
+
+         TrigramFile entry;
+         entry.path     = relativePath(root, name);
+         entry.size     = info.size();
+         entry.modified = info.lastModified().toMSecsSinceEpoch();
+         entry.indexed  = false;
+
+         const int id = data->m_files.size();
+
+         if (! oldData.isNull()) {
+            int oldId = oldData->fileId(entry.path);
+
+            if (oldId != -1) {
+               const TrigramFile &oldEntry = oldData->file(oldId);
+
+               if (oldEntry.size == entry.size && oldEntry.modified == entry.modified) {
+                  // unchanged, postings are copied below
+                  entry.indexed  = oldEntry.indexed;
+                  keptIds[oldId] = id;
+                  ++keptCount;
+
+                  data->m_fileIds.insert(entry.path, id);
+                  data->m_files.append(entry);
+
+                  continue;
+               }
+            }
+         }
+
+         isChanged = true;
+
+         if (entry.size <= INDEX_FILE_LIMIT) {
+            QFile file(name);
+
+            if (file.open(QIODevice::ReadOnly)) {
+               QByteArray text = file.readAll();
+
+               const int sniffSize = qMin(text.size(), SNIFF_SIZE);
+
+               // UTF-16 trigrams never match a UTF-8 pattern, these files are always searched
+               if (TextSearch::isText(text.constData(), sniffSize) && ! TextSearch::isUtf16(text.constData(), sniffSize)) {
+                  entry.indexed = true;
+
+                  for (quint32 key : extractTrigrams(text.constData(), text.size())) {
+                     data->m_postings[key].append(id);
+                  }
+               }
+            }
+         }
+
+         data->m_fileIds.insert(entry.path, id);
+         data->m_files.append(entry);
+      }
+
+      QDirIterator dirIter(path, QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+
+      while (dirIter.hasNext()) {
+         dirIter.next();
+
+         if (! skipFolders.contains(dirIter.fileName())) {
+            dirList.append(dirIter.filePath());
+         }
+      }
+   }
+
+   if (! oldData.isNull() && keptCount != oldData->fileCount()) {
+      // removed files
+      isChanged = true;
+   }
+
+   if (! isChanged) {
+      // the saved index is current, it is not written again
+      QMutexLocker lock(&m_mutex);
+      m_updating.remove(root);
+
+      return;
+   }
+
+   if (! m_stop) {
+
+      if (! oldData.isNull()) {
+         for (auto iter = oldData->m_postings.constBegin(); iter != oldData->m_postings.constEnd(); ++iter) {
+            QVector<int> *ids = nullptr;
+
+            for (int oldId : iter.value()) {
+               int newId = keptIds[oldId];
+
+               if (newId != -1) {
+                  if (ids == nullptr) {
+                     ids = &data->m_postings[iter.key()];
+                  }
+
+                  ids->append(newId);
+               }
+            }
+         }
+      }
+
+      for (auto &ids : data->m_postings) {
+         std::sort(ids.begin(), ids.end());
+      }
+
+      save(*data);
+   }
+
+   QMutexLocker lock(&m_mutex);
+
+   if (! m_stop) {
+      m_indexes.insert(root, data);
+   }
+
+   m_updating.remove(root);
+}
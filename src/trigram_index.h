@@ -0,0 +1,111 @@
+/**************************************************************************
+*
+* Copyright (c) 2012-2025 Barbara Geller
+*
+* Diamond Editor is free software. You can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* version 2 as published by the Free Software Foundation.
+*
+* Diamond Editor is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*
+* https://www.gnu.org/licenses/
+*
+***************************************************************************/
+
+#ifndef TRIGRAM_INDEX_H
+#define TRIGRAM_INDEX_H
+
+#include <QBitArray>
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+#include <atomic>
+
+struct TrigramFile
+{
+   // relative to the search root, separated by '/'
+   QString path;
+
+   qint64 size;
+   qint64 modified;
+
+   // false for binary and very large files, these are always searched
+   bool indexed;
+};
+
+// files below one search root and the files containing each trigram, never changed once built
+class TrigramIndexData
+{
+   public:
+      // one bit per file, set when the file may contain the pattern
+      // false when the pattern is too short to use the index
+      bool candidates(const QByteArray &pattern, QBitArray &retval) const;
+
+      // -1 when the file is not in the index
+      int fileId(const QString &path) const {
+         return m_fileIds.value(path, -1);
+      }
+
+      const TrigramFile &file(int id) const {
+         return m_files[id];
+      }
+
+      int fileCount() const {
+         return m_files.size();
+      }
+
+   private:
+      QString m_root;
+
+      QVector<TrigramFile> m_files;
+      QHash<QString, int> m_fileIds;
+
+      // trigrams of the text folded to lower case ASCII, file ids in ascending order
+      QHash<quint32, QVector<int>> m_postings;
+
+      friend class TrigramIndex;
+};
+
+// one index file per search root, built and updated on a background thread
+class TrigramIndex
+{
+   public:
+      TrigramIndex(const QString &indexPath);
+      ~TrigramIndex();
+
+      // root must be passed through rootPath(), file names are relative to the root
+      static QString rootPath(const QString &folder);
+      static QString relativePath(const QString &root, const QString &fileName);
+
+      // loads the index from disk the first time, nullptr when the root has not been indexed
+      QSharedPointer<const TrigramIndexData> get_Index(const QString &root);
+
+      // reads only the files which were added or changed since the index was last saved
+      void update(const QString &root, const QStringList &skipFolders);
+
+   private:
+      QString indexFileName(const QString &root) const;
+      QSharedPointer<TrigramIndexData> load(const QString &root) const;
+      void save(const TrigramIndexData &data) const;
+      void runUpdate(const QString &root, const QStringList &skipFolders);
+
+      QString m_indexPath;
+
+      QMutex m_mutex;
+      QHash<QString, QSharedPointer<const TrigramIndexData>> m_indexes;
+      QSet<QString> m_updating;
+
+      std::atomic<bool> m_stop;
+      QThreadPool m_pool;
+};
+
+#endif